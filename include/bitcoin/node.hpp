@@ -15,14 +15,31 @@
  */
 
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/announcer.hpp>
+#include <bitcoin/node/block_cache.hpp>
+#include <bitcoin/node/bloom_filter.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/compact_filter.hpp>
 #include <bitcoin/node/configuration.hpp>
 #include <bitcoin/node/define.hpp>
+#include <bitcoin/node/filter_index.hpp>
+#include <bitcoin/node/filtered_block.hpp>
 #include <bitcoin/node/full_node.hpp>
+#include <bitcoin/node/header_queue.hpp>
 #include <bitcoin/node/indexer.hpp>
+#include <bitcoin/node/inventory_filter.hpp>
+#include <bitcoin/node/peer_scores.hpp>
 #include <bitcoin/node/poller.hpp>
+#include <bitcoin/node/pool_inventory.hpp>
+#include <bitcoin/node/prevalidate.hpp>
+#include <bitcoin/node/raw_block.hpp>
+#include <bitcoin/node/reorder_buffer.hpp>
+#include <bitcoin/node/request_tracker.hpp>
 #include <bitcoin/node/responder.hpp>
 #include <bitcoin/node/session.hpp>
 #include <bitcoin/node/settings.hpp>
+#include <bitcoin/node/sync_state.hpp>
+#include <bitcoin/node/sync_statistics.hpp>
 #include <bitcoin/node/version.hpp>
 
 #endif
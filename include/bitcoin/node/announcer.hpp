@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_ANNOUNCER_HPP
+#define LIBBITCOIN_NODE_ANNOUNCER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+#include <bitcoin/node/inventory_filter.hpp>
+#include <bitcoin/node/responder.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe registry of channels, each with a filter of the inventory it
+ * is known to have, because the peer announced or sent it or because it was
+ * announced to the peer. Announcements skip inventory known to a channel.
+ * Relayed inventory is queued for each channel and trickled out in batches
+ * after a random delay. New blocks are coalesced over a short window into a
+ * single announcement to each channel, sent as headers to channels that
+ * have asked for them (BIP130) and as inventory to others. Transactions are
+ * not relayed to channels that asked not to be sent them in their version
+ * until they load a bloom filter, and are relayed to channels with a bloom
+ * filter only if the filter matches (BIP37).
+ */
+class BCN_API announcer
+{
+public:
+    /**
+     * Construct the announcer.
+     * @param[in]   pool                   The threadpool for relay timers.
+     * @param[in]   responder              The holder of peer bloom filters.
+     * @param[in]   trickle_milliseconds   The mean delay of relay batches.
+     * @param[in]   announce_milliseconds  The block announcement window.
+     */
+    announcer(threadpool& pool, responder& responder,
+        uint32_t trickle_milliseconds, uint32_t announce_milliseconds);
+
+    /// This class is not copyable.
+    announcer(const announcer&) = delete;
+    void operator=(const announcer&) = delete;
+
+    /// Register the channel and track the inventory it announces and sends.
+    void monitor(network::channel::ptr node);
+
+    /// Record inventory as known to the channel.
+    void mark(network::channel::ptr node,
+        const message::inventory_vector::list& inventories);
+
+    /**
+     * Announce inventory to a channel, skipping any already known to it.
+     * @param[in]   node    The channel.
+     * @param[in]   packet  The inventory to announce.
+     * @return The number of inventories sent.
+     */
+    size_t announce(network::channel::ptr node,
+        const message::inventory& packet);
+
+    /**
+     * Queue a transaction for the next batch to each channel that doesn't
+     * know it and that accepts it.
+     * @param[in]   tx    The transaction.
+     * @param[in]   hash  The hash of the transaction.
+     */
+    void relay(const chain::transaction& tx, const hash_digest& hash);
+
+    /**
+     * Queue new blocks for the next block announcement. Queued blocks that
+     * do not link to the new blocks have been reorganized out and are
+     * dropped.
+     * @param[in]   headers  The headers of the new blocks, in chain order.
+     */
+    void announce_blocks(const chain::header::list& headers);
+
+    /// Cancel pending relay batches and block announcements.
+    void stop();
+
+    /**
+     * Select the new blocks to announce to a channel, those not known to it,
+     * which are then recorded as known. They are selected as headers if the
+     * peer asked for headers (BIP130), they are few and they connect to a
+     * block known to the peer, otherwise as inventory.
+     * @param[in]   known          The inventory known to the channel.
+     * @param[in]   headers        The peer asked for headers announcements.
+     * @param[in]   blocks         The headers of the new blocks, in order.
+     * @param[out]  out_headers    The headers to announce, if any.
+     * @param[out]  out_inventory  The inventory to announce, if any.
+     */
+    static void select_blocks(inventory_filter& known, bool headers,
+        const chain::header::list& blocks, message::headers& out_headers,
+        message::inventory& out_inventory);
+
+private:
+    struct peer
+    {
+        peer(size_t capacity, bool relay);
+
+        inventory_filter known;
+        message::inventory_vector::list pending;
+        deadline::ptr timer;
+        bool headers;
+        bool relay;
+    };
+
+    typedef std::map<network::channel::ptr, peer> peer_map;
+
+    void receive_inventory(const code& ec, const message::inventory& packet,
+        network::channel::ptr node);
+    void receive_block(const code& ec, const message::block& block,
+        network::channel::ptr node);
+    void receive_send_headers(const code& ec,
+        const message::send_headers& packet, network::channel::ptr node);
+    void handle_stop(const code& ec, network::channel::ptr node);
+    void handle_trickle(const code& ec, network::channel::ptr node);
+    void handle_announce(const code& ec);
+
+    // Caller must hold the mutex.
+    void start_trickle(network::channel::ptr node, peer& peer);
+
+    message::inventory filter(peer& peer,
+        const message::inventory_vector::list& inventories);
+
+    void send(network::channel::ptr node, const message::inventory& packet);
+    void send(network::channel::ptr node, const message::headers& packet);
+
+    threadpool& pool_;
+    responder& responder_;
+    const uint32_t trickle_milliseconds_;
+    const uint32_t announce_milliseconds_;
+    bool stopped_;
+    peer_map peers_;
+    chain::header::list blocks_;
+    deadline::ptr announce_timer_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
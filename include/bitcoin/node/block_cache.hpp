@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_BLOCK_CACHE_HPP
+#define LIBBITCOIN_NODE_BLOCK_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+#include <bitcoin/node/raw_block.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe cache of serialized blocks, bounded by the total size of the
+ * serializations. The least recently used blocks are evicted first. Cached
+ * blocks are shared, so a block requested by many peers is serialized once.
+ */
+class BCN_API block_cache
+{
+public:
+    block_cache(size_t maximum_bytes);
+
+    /// This class is not copyable.
+    block_cache(const block_cache&) = delete;
+    void operator=(const block_cache&) = delete;
+
+    /// Add or refresh a block, evicting others to fit. A block larger than
+    /// the cache is not cached.
+    void store(raw_block::ptr block);
+
+    /// Obtain a block and mark it as recently used, nullptr if not cached.
+    raw_block::ptr find(const hash_digest& hash);
+
+    /// The number of cached blocks.
+    size_t size() const;
+
+    /// The total size of the cached serializations.
+    size_t bytes() const;
+
+private:
+    typedef std::list<raw_block::ptr> block_list;
+    typedef std::unordered_map<hash_digest, block_list::iterator> block_map;
+
+    const size_t maximum_bytes_;
+    size_t bytes_;
+    block_list blocks_;
+    block_map index_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
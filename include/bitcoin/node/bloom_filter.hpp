@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_BLOOM_FILTER_HPP
+#define LIBBITCOIN_NODE_BLOOM_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A connection bloom filter (BIP37), loaded by an SPV peer to select the
+ * transactions that it is sent. Matching a transaction may insert its
+ * matched outputs into the filter, as selected by the update flags, so
+ * that transactions spending them also match. This class is not thread
+ * safe.
+ */
+class BCN_API bloom_filter
+{
+public:
+    /// The protocol limits of a filter.
+    static constexpr size_t max_filter_bytes = 36000;
+    static constexpr uint32_t max_hash_functions = 50;
+    static constexpr size_t max_element_bytes = 520;
+
+    /// The update flags of a filter.
+    enum update : uint8_t
+    {
+        update_none = 0,
+        update_all = 1,
+        update_p2pubkey_only = 2,
+        update_mask = 3
+    };
+
+    /**
+     * Construct a filter loaded by a peer.
+     * @param[in]   data            The filter bits.
+     * @param[in]   hash_functions  The number of hash functions.
+     * @param[in]   tweak           The seed of the hash functions.
+     * @param[in]   flags           The update flags.
+     */
+    bloom_filter(const data_chunk& data, uint32_t hash_functions,
+        uint32_t tweak, uint8_t flags);
+
+    /**
+     * Construct an empty filter sized for a false positive rate.
+     * @param[in]   elements             The expected number of elements.
+     * @param[in]   false_positive_rate  The rate at the expected elements.
+     * @param[in]   tweak                The seed of the hash functions.
+     * @param[in]   flags                The update flags.
+     */
+    bloom_filter(size_t elements, double false_positive_rate, uint32_t tweak,
+        uint8_t flags);
+
+    /// The filter is within the protocol limits.
+    bool is_valid() const;
+
+    /// The filter bits.
+    const data_chunk& data() const;
+
+    /// The number of hash functions.
+    uint32_t hash_functions() const;
+
+    /// Insert an element into the filter.
+    void insert(data_slice element);
+
+    /// The element has been inserted (or is a false positive).
+    bool contains(data_slice element) const;
+
+    /**
+     * Test a transaction against the filter, updating the filter with the
+     * outputs of a matched transaction as selected by the update flags.
+     * @param[in]   tx    The transaction.
+     * @param[in]   hash  The hash of the transaction.
+     * @return True if the transaction hash, an output script data element,
+     * a spent output or an input script data element is in the filter.
+     */
+    bool match(const chain::transaction& tx, const hash_digest& hash);
+
+private:
+    uint32_t position(data_slice element, uint32_t function) const;
+    void update_state();
+
+    data_chunk data_;
+    uint32_t hash_functions_;
+    uint32_t tweak_;
+    uint8_t flags_;
+
+    // All bits set matches everything and none set matches nothing, which
+    // avoids hashing for filters of either extreme.
+    bool full_;
+    bool empty_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
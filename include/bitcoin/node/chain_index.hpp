@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_CHAIN_INDEX_HPP
+#define LIBBITCOIN_NODE_CHAIN_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe in-memory index of the block hashes and headers of the local
+ * chain. Headers are held serialized (80 bytes each) in a contiguous array
+ * indexed by height. The index is loaded from the chain at startup, in
+ * batches of concurrent reads, and is then maintained from the
+ * reorganization subscription, so that block locators, hash lookups and
+ * headers do not require database reads.
+ */
+class BCN_API chain_index
+{
+public:
+    typedef std::function<void(const code&)> result_handler;
+
+    chain_index(blockchain::block_chain& chain);
+
+    /// This class is not copyable.
+    chain_index(const chain_index&) = delete;
+    void operator=(const chain_index&) = delete;
+
+    /**
+     * Load the hashes of the chain and subscribe to reorganizations.
+     * @param[in]   height   The height of the top block of the chain.
+     * @param[in]   handler  Called once the index has been loaded.
+     */
+    void start(uint64_t height, result_handler handler);
+
+    /**
+     * Replace the indexed blocks above the fork point. This is applied from
+     * the reorganization subscription.
+     * @param[in]   fork_point  The height of the highest common block.
+     * @param[in]   new_blocks  The blocks above the fork point, lowest first.
+     */
+    void reorganize(uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks);
+
+    /// The number of indexed blocks (including the genesis block).
+    uint64_t size() const;
+
+    /// The hash of the top indexed block, null_hash if empty.
+    hash_digest top_hash() const;
+
+    /// The block is in the local chain.
+    bool exists(const hash_digest& hash) const;
+
+    /**
+     * Obtain the height of an indexed block.
+     * @param[out]  out_height  The height of the block.
+     * @param[in]   hash        The hash of the block.
+     * @return True if the block is indexed.
+     */
+    bool find(uint64_t& out_height, const hash_digest& hash) const;
+
+    /**
+     * Obtain the hash of an indexed block.
+     * @param[out]  out_hash  The hash of the block.
+     * @param[in]   height    The height of the block.
+     * @return True if the height is indexed.
+     */
+    bool hash_at(hash_digest& out_hash, uint64_t height) const;
+
+    /**
+     * Find the highest block of a peer's locator that is in the index.
+     * @param[in]   locator  The peer's block locator, highest first.
+     * @return The height of the block, or zero (genesis) if none is indexed.
+     */
+    uint64_t fork_height(const message::block_locator& locator) const;
+
+    /**
+     * Obtain consecutive hashes of the indexed chain.
+     * @param[in]   start  The height of the first hash.
+     * @param[in]   stop   The hash at which to stop (excluded), or null_hash.
+     * @param[in]   limit  The maximum number of hashes.
+     * @return The hashes, lowest height first.
+     */
+    hash_list hashes(uint64_t start, const hash_digest& stop,
+        size_t limit) const;
+
+    /**
+     * Obtain consecutive headers of the indexed chain.
+     * @param[in]   start  The height of the first header.
+     * @param[in]   stop   The hash of the last header to include, or null_hash.
+     * @param[in]   limit  The maximum number of headers.
+     * @return The headers, lowest height first.
+     */
+    chain::header::list headers(uint64_t start, const hash_digest& stop,
+        size_t limit) const;
+
+    /// The block locator of the indexed chain, empty if not loaded.
+    message::block_locator locator() const;
+
+private:
+    typedef std::unordered_map<hash_digest, uint64_t> height_map;
+
+    // A header serialized without its transaction count.
+    typedef byte_array<80> header_bytes;
+
+    // The headers of a range of heights, fetched concurrently.
+    struct batch
+    {
+        typedef std::shared_ptr<batch> ptr;
+
+        uint64_t start;
+        chain::header::list headers;
+        size_t remaining;
+        code result;
+        std::mutex mutex;
+    };
+
+    void load(uint64_t top, result_handler handler);
+    void handle_fetch_height(const code& ec, uint64_t top,
+        result_handler handler);
+    void handle_fetch_header(const code& ec, const chain::header& header,
+        uint64_t height, uint64_t top, batch::ptr headers,
+        result_handler handler);
+    void verify(uint64_t top, result_handler handler);
+    void handle_verify(const code& ec, const chain::header& header,
+        uint64_t height, uint64_t top, result_handler handler);
+    void handle_reorganize(const code& ec, uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks,
+        const blockchain::block_chain::list& replaced_blocks);
+
+    // Caller must hold the mutex.
+    bool link(const chain::header::list& headers, uint64_t start);
+    void push(const chain::header& header);
+    void truncate(uint64_t size);
+
+    blockchain::block_chain& blockchain_;
+    hash_list hashes_;
+    std::vector<header_bytes> headers_;
+    height_map heights_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
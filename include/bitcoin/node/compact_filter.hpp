@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_COMPACT_FILTER_HPP
+#define LIBBITCOIN_NODE_COMPACT_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * The basic compact block filter (BIP158), a Golomb-Rice coded set of the
+ * output scripts of a block and of the scripts of the outputs it spends.
+ * Elements are hashed with SipHash-2-4, keyed by the block hash, into the
+ * range of the element count times the inverse false positive rate.
+ */
+class BCN_API compact_filter
+{
+public:
+    typedef std::vector<data_chunk> element_list;
+
+    /// The Golomb-Rice parameter of the basic filter.
+    static constexpr uint8_t golomb_bits = 19;
+
+    /// The inverse false positive rate of the basic filter.
+    static constexpr uint64_t inverse_rate = 784931;
+
+    /// SipHash-2-4 of the data with the key words.
+    static uint64_t siphash(uint64_t key0, uint64_t key1, data_slice data);
+
+    /**
+     * Obtain the elements of the basic filter of a block.
+     * @param[in]   block     The block.
+     * @param[in]   prevouts  The scripts of the outputs spent by the block.
+     * @return The non-empty output scripts other than data carriers (which
+     * start with op_return) and the spent output scripts.
+     */
+    static element_list elements(const chain::block& block,
+        const std::vector<chain::script>& prevouts);
+
+    /**
+     * Build a filter.
+     * @param[in]   block_hash  The hash of the block, which keys the filter.
+     * @param[in]   elements    The elements, which may have duplicates.
+     * @return The serialized filter.
+     */
+    static data_chunk build(const hash_digest& block_hash,
+        const element_list& elements);
+
+    /// The element may be in the filter (or is a false positive).
+    static bool match(const data_chunk& filter, const hash_digest& block_hash,
+        data_slice element);
+
+    /// Any of the elements may be in the filter.
+    static bool match_any(const data_chunk& filter,
+        const hash_digest& block_hash, const element_list& elements);
+
+    /// The filter header, which commits to the filter and to the header of
+    /// the filter of the previous block (null_hash for the genesis block).
+    static hash_digest header(const data_chunk& filter,
+        const hash_digest& previous_header);
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
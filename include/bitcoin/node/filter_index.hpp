@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_FILTER_INDEX_HPP
+#define LIBBITCOIN_NODE_FILTER_INDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/compact_filter.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+#define LOG_FILTERS "filters"
+
+/**
+ * A thread safe, persistent index of the basic compact filter (BIP158) and
+ * filter header of each block of the chain. Filters are built from the
+ * reorganization subscription in batches of consecutive blocks, whose
+ * filters are built concurrently and then appended in height order, so a
+ * chain that is being downloaded, or an index that is behind at startup, is
+ * caught up without a separate rescan. Filters above a reorganization fork
+ * point are discarded. A batch that cannot be built, because its blocks are
+ * not yet indexed or cannot be read, is retried after a delay. Each record
+ * of the file holds the block hash, the filter header, the filter size and
+ * the filter.
+ */
+class BCN_API filter_index
+{
+public:
+    /**
+     * Construct the index.
+     * @param[in]   pool   The threadpool for building filters.
+     * @param[in]   chain  The blockchain.
+     * @param[in]   index  The index of the chain, which must be started.
+     * @param[in]   file   The path of the filter file.
+     */
+    filter_index(threadpool& pool, blockchain::block_chain& chain,
+        chain_index& index, const boost::filesystem::path& file);
+
+    /// This class is not copyable.
+    filter_index(const filter_index&) = delete;
+    void operator=(const filter_index&) = delete;
+
+    /**
+     * Load the filter file, discarding filters of blocks no longer in the
+     * chain, and build the filters of the chain above it.
+     * @param[in]   height  The height of the top block of the chain.
+     * @return False if the file cannot be opened.
+     */
+    bool start(uint64_t height);
+
+    /// Stop building filters and close the file.
+    void stop();
+
+    /// The number of indexed filters (the height of the next filter).
+    uint64_t size() const;
+
+    /**
+     * Read the filter of a block.
+     * @param[out]  out_filter  The serialized filter.
+     * @param[in]   height      The height of the block.
+     * @return True if the filter is indexed.
+     */
+    bool filter(data_chunk& out_filter, uint64_t height);
+
+    /**
+     * Obtain the filter header of a block.
+     * @param[out]  out_header  The filter header.
+     * @param[in]   height      The height of the block.
+     * @return True if the filter is indexed.
+     */
+    bool filter_header(hash_digest& out_header, uint64_t height) const;
+
+    /**
+     * Test whether any of the scripts may be paid or spent in a block.
+     * @param[in]   scripts  The serialized output scripts.
+     * @param[in]   height   The height of the block.
+     * @return True if the block may match (or the filter is not indexed).
+     */
+    bool match_any(const compact_filter::element_list& scripts,
+        uint64_t height);
+
+private:
+    typedef std::shared_ptr<const chain::block> block_ptr;
+
+    struct entry
+    {
+        hash_digest block_hash;
+        hash_digest header;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    // The join state of the filters of a run of consecutive blocks.
+    struct batch
+    {
+        typedef std::shared_ptr<batch> ptr;
+
+        uint64_t first;
+        hash_list block_hashes;
+        std::vector<data_chunk> filters;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed;
+    };
+
+    // The join state of the spent outputs of a single block.
+    struct block_job
+    {
+        typedef std::shared_ptr<block_job> ptr;
+
+        batch::ptr owner;
+        size_t position;
+        block_ptr block;
+        std::vector<chain::script> prevouts;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed;
+    };
+
+    void handle_reorganize(const code& ec, uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks,
+        const blockchain::block_chain::list& replaced_blocks);
+    void build_next();
+    void handle_fetch_block(const code& ec, const chain::block& block,
+        batch::ptr batch, size_t position);
+    void handle_fetch_previous(const code& ec,
+        const chain::transaction& previous, uint32_t index,
+        block_job::ptr job, size_t input);
+    void finish_input(block_job::ptr job, bool failed);
+    void build_filter(block_job::ptr job);
+    void finish_block(batch::ptr batch, bool failed);
+    void append(batch::ptr batch);
+    void handle_retry(const code& ec);
+
+    // Caller must hold the mutex.
+    void schedule_retry();
+    bool open();
+    bool load();
+    bool read(data_chunk& out_filter, const entry& entry);
+    void truncate(uint64_t size);
+    bool write(const hash_digest& block_hash, const data_chunk& filter);
+
+    threadpool& pool_;
+    dispatcher dispatch_;
+    blockchain::block_chain& blockchain_;
+    chain_index& index_;
+    const boost::filesystem::path path_;
+    std::fstream file_;
+    std::vector<entry> entries_;
+    deadline::ptr retry_timer_;
+    uint64_t target_;
+    bool building_;
+    bool stopped_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
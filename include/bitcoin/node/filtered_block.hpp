@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_FILTERED_BLOCK_HPP
+#define LIBBITCOIN_NODE_FILTERED_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/node/bloom_filter.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A merkle block message (BIP37): a block header and the partial merkle
+ * tree that proves the inclusion of the transactions of the block that
+ * match a peer's bloom filter. The matched transactions are sent after it.
+ */
+class BCN_API filtered_block
+{
+public:
+    static const std::string command;
+
+    /**
+     * Build the merkle block by passing each transaction of the block through
+     * the filter, in block order, which may update the filter.
+     * @param[in]   block   The block.
+     * @param[in]   filter  The peer's filter.
+     */
+    filtered_block(const chain::block& block, bloom_filter& filter);
+
+    /// The positions of the matched transactions in the block.
+    const std::vector<size_t>& matches() const;
+
+    /// The hashes of the partial merkle tree, in depth first order.
+    const hash_list& hashes() const;
+
+    /// The wire serialization of the message.
+    data_chunk to_data() const;
+
+    /// The size of the serialization in bytes.
+    uint64_t satoshi_size() const;
+
+private:
+    size_t width(size_t height) const;
+    hash_digest subtree_hash(size_t height, size_t position) const;
+    void traverse(size_t height, size_t position);
+
+    const chain::header header_;
+    hash_list tx_hashes_;
+    std::vector<bool> matched_;
+    std::vector<size_t> matches_;
+    hash_list hashes_;
+    std::vector<bool> bits_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
@@ -24,12 +24,17 @@
 #include <functional>
 #include <string>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/announcer.hpp>
+#include <bitcoin/node/chain_index.hpp>
 #include <bitcoin/node/configuration.hpp>
 #include <bitcoin/node/define.hpp>
+#include <bitcoin/node/filter_index.hpp>
 #include <bitcoin/node/indexer.hpp>
 #include <bitcoin/node/poller.hpp>
+#include <bitcoin/node/pool_inventory.hpp>
 #include <bitcoin/node/responder.hpp>
 #include <bitcoin/node/session.hpp>
+#include <bitcoin/node/sync_state.hpp>
 
 namespace libbitcoin {
 namespace node {
@@ -75,7 +80,11 @@ public:
     virtual blockchain::block_chain& blockchain();
     virtual blockchain::transaction_pool& transaction_pool();
     virtual node::indexer& transaction_indexer();
+    virtual node::filter_index& compact_filters();
     virtual network::p2p& network();
+    virtual node::peer_score::list peer_scores() const;
+    virtual node::sync_progress progress() const;
+    virtual const node::sync_state& sync() const;
     virtual threadpool& pool();
 
 protected:
@@ -112,8 +121,13 @@ protected:
 
     threadpool node_threads_;
     node::indexer tx_indexer_;
+    node::chain_index chain_index_;
+    node::filter_index filter_index_;
+    node::sync_state sync_state_;
+    node::pool_inventory pool_inventory_;
     node::poller poller_;
     node::responder responder_;
+    node::announcer announcer_;
     node::session session_;
 
 private:
@@ -124,6 +138,9 @@ private:
     void handle_network_start(const code& ec, result_handler handler);
     void handle_fetch_height(const code& ec, uint64_t height,
         result_handler handler);
+    void handle_index_start(const code& ec, uint64_t height,
+        result_handler handler);
+    void handle_poller_start(const code& ec, result_handler handler);
     void handle_manual_connect(const code& ec, network::channel::ptr channel,
         const config::endpoint& endpoint);
     void handle_tx_indexed(const code& ec, const hash_digest& hash);
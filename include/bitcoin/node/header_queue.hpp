@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_HEADER_QUEUE_HPP
+#define LIBBITCOIN_NODE_HEADER_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe tree of headers above the local chain. Headers are accepted
+ * only if they link to a known header, carry the difficulty required at their
+ * height, satisfy that proof of work and agree with any checkpoint. The queue
+ * follows the branch with the most accumulated work, and block hashes are
+ * reserved from it in height order for download.
+ */
+class BCN_API header_queue
+{
+public:
+    /// The number of blocks between difficulty retargets.
+    static constexpr uint64_t retarget_interval = 2016;
+
+    header_queue(const config::checkpoint::list& checkpoints, bool testnet);
+
+    /// This class is not copyable.
+    header_queue(const header_queue&) = delete;
+    void operator=(const header_queue&) = delete;
+
+    /// The number of queued headers above the top of the local chain.
+    size_t size() const;
+
+    /// The height of the lowest header retained in the queue.
+    uint64_t first_height() const;
+
+    /// The height of the last header (or of the chain top if none queued).
+    uint64_t last_height() const;
+
+    /// The hash of the last header (or of the chain top if none queued).
+    hash_digest last_hash() const;
+
+    /**
+     * Clear the queue and seed it with the top headers of the local chain.
+     * The difficulty of a header depends upon its retarget period, so the
+     * headers should begin at a retarget height.
+     * @param[in]   headers  The headers, ending with the chain top.
+     * @param[in]   height   The height of the first header.
+     */
+    void initialize(const chain::header::list& headers, uint64_t height);
+
+    /**
+     * Validate and add headers, skipping any already known. The queue moves
+     * to the branch of the last accepted header if it has more work.
+     * @param[in]   headers           The headers to add, in chain order.
+     * @param[out]  out_fork_height   The height below any replaced headers.
+     * @param[out]  out_replaced      Queued hashes of a replaced branch.
+     * @return error::bad_stream if the headers do not link to a known header,
+     * error::incorrect_proof_of_work if a header has the wrong difficulty,
+     * error::proof_of_work or error::checkpoints_failed if a header is invalid,
+     * error::operation_failed if a header has been banned.
+     */
+    code enqueue(const chain::header::list& headers,
+        uint64_t& out_fork_height, hash_list& out_replaced);
+
+    /**
+     * Advance the top of the local chain to a block of the queue, or append
+     * the block if it extends the queue.
+     * @param[in]   header  The header of the block accepted into the chain.
+     * @param[in]   height  The height of the block.
+     * @return False if the chain has diverged from the queue.
+     */
+    bool confirm(const chain::header& header, uint64_t height);
+
+    /**
+     * Obtain the height of a queued header.
+     * @param[out]  out_height  The height of the header.
+     * @param[in]   hash        The hash of the header.
+     * @return True if the header is queued above the chain top.
+     */
+    bool find(uint64_t& out_height, const hash_digest& hash) const;
+
+    /**
+     * Reserve unrequested block hashes in height order.
+     * @param[in]   count       The maximum number of hashes to reserve.
+     * @param[in]   max_height  The maximum height of hashes to reserve.
+     * @return The reserved hashes, lowest height first.
+     */
+    hash_list reserve(size_t count, uint64_t max_height=max_uint64);
+
+    /// Return reserved block hashes so that they may be reserved again.
+    void release(const hash_list& hashes);
+
+    /// Record that the block of a queued header has been received, so that
+    /// it is not reserved again.
+    void complete(const hash_digest& hash);
+
+    /**
+     * Remove the header of an invalid block and every header above it. The
+     * removed headers are banned so that they are not accepted again.
+     * @param[in]   hash  The hash of the invalid block.
+     * @return The removed queued hashes, lowest height first.
+     */
+    hash_list ban(const hash_digest& hash);
+
+    /// The header has been banned.
+    bool banned(const hash_digest& hash) const;
+
+    /// The header is retained on a branch with less work than the queue.
+    bool superseded(const hash_digest& hash) const;
+
+    /// The block locator of the queue, down to its first height.
+    message::block_locator locator() const;
+
+private:
+    struct node
+    {
+        hash_digest parent;
+        uint64_t height;
+        uint32_t bits;
+        uint32_t timestamp;
+
+        // The timestamp of the first block of the retarget period.
+        uint32_t period_start;
+
+        // The bits of the last block not mined at testnet minimum difficulty.
+        uint32_t normal_bits;
+
+        // The work of the branch from the first header.
+        hash_number work;
+    };
+
+    typedef std::unordered_map<hash_digest, node> node_map;
+
+    // Caller must hold the mutex.
+    uint64_t last() const;
+    bool on_queue(const hash_digest& hash, uint64_t height) const;
+    node make_node(const chain::header& header, uint64_t height,
+        const node* parent) const;
+    uint32_t work_required(const node& parent, uint32_t timestamp) const;
+    bool is_checkpoint_conflict(const hash_digest& hash,
+        uint64_t height) const;
+    void reorganize(const hash_digest& tip, uint64_t& out_fork_height,
+        hash_list& out_replaced);
+    hash_list remove_unlinked();
+    void prune();
+
+    const config::checkpoint::list checkpoints_;
+    const bool testnet_;
+    uint64_t first_height_;
+    uint64_t top_height_;
+    uint64_t next_height_;
+    node_map nodes_;
+    std::deque<hash_digest> hashes_;
+    std::unordered_set<hash_digest> side_;
+    std::set<uint64_t> released_;
+    std::set<uint64_t> completed_;
+    std::unordered_set<hash_digest> banned_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
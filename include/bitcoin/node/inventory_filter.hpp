@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_INVENTORY_FILTER_HPP
+#define LIBBITCOIN_NODE_INVENTORY_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A rolling bloom filter of inventory hashes. Hashes are inserted into the
+ * current of two generations, and once it holds the capacity it replaces the
+ * previous generation. So at least the last capacity hashes are always
+ * contained, with a small rate of false positives. This class is not thread
+ * safe.
+ */
+class BCN_API inventory_filter
+{
+public:
+    /**
+     * Construct an empty filter.
+     * @param[in]   capacity  The number of recent hashes that are retained.
+     */
+    inventory_filter(size_t capacity);
+
+    /// Insert the hash into the filter.
+    void insert(const hash_digest& hash);
+
+    /// The hash has been inserted (or is a false positive).
+    bool contains(const hash_digest& hash) const;
+
+    /// Remove all hashes from the filter.
+    void clear();
+
+private:
+    typedef std::vector<bool> bit_set;
+
+    size_t position(const hash_digest& hash, size_t function) const;
+    bool contains(const bit_set& bits, const hash_digest& hash) const;
+
+    const size_t capacity_;
+    const size_t size_;
+    const uint64_t tweak_;
+    size_t inserted_;
+    bit_set current_;
+    bit_set previous_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
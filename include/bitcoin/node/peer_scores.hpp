@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_PEER_SCORES_HPP
+#define LIBBITCOIN_NODE_PEER_SCORES_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/// A snapshot of the block download performance of a channel.
+struct BCN_API peer_score
+{
+    typedef std::vector<peer_score> list;
+
+    config::authority authority;
+    uint64_t blocks;
+    uint64_t bytes;
+    uint32_t latency_milliseconds;
+    uint64_t bytes_per_second;
+    uint32_t stalls;
+};
+
+/**
+ * Thread safe block download measurements for each channel. The latency of
+ * a block is the time since the previous block (or since the request if none
+ * were outstanding), and the rate is its size over that latency. Both are
+ * smoothed. A stall halves the rate of the channel, which reduces the share
+ * of blocks it is given. Channels are measured from when they are added until
+ * they are removed, and are otherwise ignored.
+ */
+class BCN_API peer_scores
+{
+public:
+    peer_scores(uint32_t stall_seconds);
+
+    /// This class is not copyable.
+    peer_scores(const peer_scores&) = delete;
+    void operator=(const peer_scores&) = delete;
+
+    /// Start measuring the channel.
+    void add(network::channel::ptr node);
+
+    /// Record that blocks have been requested from the channel.
+    void requested(network::channel::ptr node, size_t count);
+
+    /// Record the receipt of a requested block from the channel.
+    void received(network::channel::ptr node, uint64_t bytes);
+
+    /**
+     * Record an expired request, counted at most once per stall period.
+     * @return The number of consecutive stalls of the channel, zero if it is
+     * not measured.
+     */
+    uint32_t stalled(network::channel::ptr node);
+
+    /// Forget the channel.
+    void remove(network::channel::ptr node);
+
+    /**
+     * Scale a number of blocks by the rate of the channel relative to the
+     * average rate of all channels. Unmeasured channels are average.
+     * @param[in]   node   The channel.
+     * @param[in]   count  The number of blocks given to an average channel.
+     * @return The number of blocks to give this channel.
+     */
+    size_t share(network::channel::ptr node, size_t count) const;
+
+    /// The smoothed block latency of the channel, zero if unmeasured.
+    std::chrono::milliseconds latency(network::channel::ptr node) const;
+
+    /// The smoothed rate of the channel in bytes per second.
+    uint64_t rate(network::channel::ptr node) const;
+
+    /// Obtain the current scores of all channels.
+    peer_score::list scores() const;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct measure
+    {
+        uint64_t blocks;
+        uint64_t bytes;
+        double latency;
+        double rate;
+        size_t outstanding;
+        uint32_t stalls;
+        clock::time_point last_activity;
+        clock::time_point last_stall;
+    };
+
+    typedef std::map<network::channel::ptr, measure> measure_map;
+
+    // Caller must hold the mutex.
+    double average_rate() const;
+
+    const clock::duration stall_period_;
+    measure_map measures_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
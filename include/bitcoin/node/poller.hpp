@@ -20,8 +20,22 @@
 #ifndef LIBBITCOIN_NODE_POLLER_HPP
 #define LIBBITCOIN_NODE_POLLER_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/configuration.hpp>
 #include <bitcoin/node/define.hpp>
+#include <bitcoin/node/header_queue.hpp>
+#include <bitcoin/node/peer_scores.hpp>
+#include <bitcoin/node/reorder_buffer.hpp>
+#include <bitcoin/node/request_tracker.hpp>
+#include <bitcoin/node/sync_state.hpp>
+#include <bitcoin/node/sync_statistics.hpp>
 
 namespace libbitcoin {
 namespace node {
@@ -29,29 +43,135 @@ namespace node {
 class BCN_API poller
 {
 public:
-    poller(threadpool& pool, blockchain::block_chain& chain);
+    typedef std::function<void(const code&)> result_handler;
+
+    poller(threadpool& pool, blockchain::block_chain& chain,
+        chain_index& index, sync_state& sync,
+        const configuration& configuration);
+
+    /// Seed the header queue with the top of the local chain.
+    void start(uint64_t height, result_handler handler);
+
+    /// Stop expiration of block requests and statistics sampling.
+    void stop();
+
+    /// The most recently sampled synchronization progress.
+    sync_progress progress() const;
 
     void monitor(network::channel::ptr node);
     void request_blocks(const hash_digest& block_hash,
         network::channel::ptr node);
 
+    /// Track a block request that the caller sends to the channel, false if
+    /// the block is already in flight.
+    bool track_block(const hash_digest& hash, network::channel::ptr node);
+
+    /// Request a block from the channel, false if it is already in flight.
+    bool request_block(const hash_digest& hash, network::channel::ptr node);
+
+    /// The block has been requested from some channel and not yet received.
+    bool requested(const hash_digest& hash) const;
+
+    /// The block is in the header queue, so that its download is scheduled
+    /// (or it has been received and awaits the store).
+    bool queued(const hash_digest& hash) const;
+
+    /// The block download scores of the monitored channels.
+    peer_score::list scores() const;
+
 private:
+    typedef std::map<network::channel::ptr, hash_list> reservations;
+    typedef std::chrono::steady_clock clock;
+
+    bool seed(uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks);
+    void handle_reorganize(const code& ec, uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks,
+        const blockchain::block_chain::list& replaced_blocks);
+    void confirm_blocks(uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks);
+    void resync(uint64_t fork_point,
+        const blockchain::block_chain::list& new_blocks);
+    void start_seed_timer();
+    void handle_seed_timer(const code& ec);
+    void reseed();
 
     ////void receive_inv(const code& ec, const inventory_type& packet,
     ////    network::channel::ptr node);
 
     void receive_block(const code& ec, const message::block& block,
         network::channel::ptr node);
+    void prevalidate_block(const message::block& block,
+        network::channel::ptr node);
+    void handle_block(const message::block& block, network::channel::ptr node);
+    void release_block();
+    void store_block(const message::block& block, network::channel::ptr node,
+        bool buffered);
     void handle_store_block(const code& ec, const blockchain::block_info& info,
-        const hash_digest& hash, network::channel::ptr node);
+        const hash_digest& hash, size_t transactions,
+        const clock::time_point& start, network::channel::ptr node,
+        bool buffered);
 
-    void get_blocks(const code& ec, const message::block_locator& locator,
+    // Headers-first synchronization.
+    void request_headers(network::channel::ptr node,
+        const hash_digest& start=null_hash);
+    void handle_send_headers(const code& ec, network::channel::ptr node);
+    void receive_headers(const code& ec, const message::headers& packet,
+        network::channel::ptr node);
+    void handle_headers(const message::headers& packet,
+        network::channel::ptr node);
+    void start_download(network::channel::ptr node);
+    void request_reserved(network::channel::ptr node);
+    void request_idle();
+    request_tracker::duration request_timeout(
+        const request_tracker::duration& latency, size_t position) const;
+    void handle_send_request(const code& ec, size_t count,
+        network::channel::ptr node);
+    void handle_channel_stop(const code& ec, network::channel::ptr node);
+    void release_reserved(network::channel::ptr node);
+
+    // Synchronization statistics.
+    void start_statistics_timer();
+    void handle_statistics_timer(const code& ec);
+
+    // Block request expiration.
+    void handle_expired(const hash_digest& hash, network::channel::ptr node);
+    void reassign(const hash_digest& hash, network::channel::ptr node);
+    void unreserve(const hash_digest& hash);
+    void invalidate(const hash_digest& hash, uint64_t height);
+    void cancel(const hash_list& hashes);
+    network::channel::ptr select_channel(network::channel::ptr exclude) const;
+
+    void get_blocks(const message::block_locator& locator,
         const hash_digest& stop, network::channel::ptr node);
     void handle_get_blocks(const code& ec, network::channel::ptr node,
         const hash_digest& start, const hash_digest& stop);
 
+    threadpool& pool_;
     dispatcher dispatch_;
     blockchain::block_chain& blockchain_;
+    chain_index& index_;
+    sync_state& sync_;
+    const bool headers_first_;
+    const size_t blocks_per_request_;
+    header_queue headers_;
+    request_tracker tracker_;
+    reorder_buffer buffer_;
+    peer_scores scores_;
+    const uint32_t stall_limit_;
+    const request_tracker::duration minimum_timeout_;
+    const request_tracker::duration maximum_timeout_;
+    const uint32_t statistics_interval_;
+    sync_statistics statistics_;
+    deadline::ptr statistics_timer_;
+    deadline::ptr seed_timer_;
+
+    // These are protected by ordered dispatch.
+    reservations reservations_;
+    std::set<network::channel::ptr> relocated_;
+    bool seeded_;
+    bool seeding_;
+    bool storing_;
 };
 
 } // namespace node
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_POOL_INVENTORY_HPP
+#define LIBBITCOIN_NODE_POOL_INVENTORY_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_set>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe set of the hashes of the transactions in the memory pool.
+ * The transaction pool cannot be enumerated, so the node records the hashes
+ * of the transactions it accepts and removes them on confirmation or
+ * discard. This answers peer mempool (BIP35) requests.
+ */
+class BCN_API pool_inventory
+{
+public:
+    pool_inventory();
+
+    /// This class is not copyable.
+    pool_inventory(const pool_inventory&) = delete;
+    void operator=(const pool_inventory&) = delete;
+
+    /// Record a transaction accepted into the pool.
+    void store(const hash_digest& hash);
+
+    /// Forget a transaction that has left the pool.
+    void remove(const hash_digest& hash);
+
+    /// The hashes of the transactions in the pool.
+    hash_list hashes() const;
+
+    /// The number of transactions in the pool.
+    size_t size() const;
+
+private:
+    std::unordered_set<hash_digest> hashes_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
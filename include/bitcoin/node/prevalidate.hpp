@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_PREVALIDATE_HPP
+#define LIBBITCOIN_NODE_PREVALIDATE_HPP
+
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * Determine if the header hash satisfies the proof of work of its bits.
+ * @param[in]   header  The header to test.
+ * @return True if the proof of work is valid.
+ */
+BCN_API bool is_valid_proof_of_work(const chain::header& header);
+
+/**
+ * Perform the checks on a block that do not depend on chain state: size,
+ * timestamp, proof of work, coinbase placement, transaction uniqueness and
+ * merkle root. These are safe to run concurrently on any number of blocks.
+ * @param[in]   block  The block to check.
+ * @return The first failed check, or error::success.
+ */
+BCN_API code prevalidate(const chain::block& block);
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
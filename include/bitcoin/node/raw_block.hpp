@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_RAW_BLOCK_HPP
+#define LIBBITCOIN_NODE_RAW_BLOCK_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A block message that holds its wire serialization, as kept by the block
+ * cache. A cached block is serialized once and its bytes are shared by every
+ * channel that it is sent to. This does not avoid deserialization of blocks
+ * read from the store, which are fetched as block objects and serialized
+ * here before they are sent.
+ */
+class BCN_API raw_block
+{
+public:
+    typedef std::shared_ptr<const raw_block> ptr;
+
+    static const std::string command;
+
+    /// Serialize the block.
+    raw_block(const chain::block& block);
+
+    /// The hash of the block.
+    const hash_digest& hash() const;
+
+    /// The wire serialization of the block.
+    const data_chunk& to_data() const;
+
+    /// The size of the serialization in bytes.
+    uint64_t satoshi_size() const;
+
+private:
+    const hash_digest hash_;
+    const data_chunk data_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
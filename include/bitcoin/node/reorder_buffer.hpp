@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_REORDER_BUFFER_HPP
+#define LIBBITCOIN_NODE_REORDER_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe, memory bounded buffer of downloaded blocks keyed by height.
+ * Blocks are released only in strict height order, starting from the next
+ * height expected by the blockchain. The buffer reports itself full once
+ * the serialized size of its blocks reaches its capacity, which is used to
+ * pause further requests. It continues to accept blocks when full.
+ */
+class BCN_API reorder_buffer
+{
+public:
+    reorder_buffer(size_t capacity_bytes);
+
+    /// This class is not copyable.
+    reorder_buffer(const reorder_buffer&) = delete;
+    void operator=(const reorder_buffer&) = delete;
+
+    /// Clear the buffer and set the next height to be released.
+    void initialize(uint64_t next_height);
+
+    /// The buffered blocks have reached the byte capacity.
+    bool full() const;
+
+    /// The number of buffered blocks.
+    size_t size() const;
+
+    /// The serialized size of the buffered blocks.
+    size_t bytes() const;
+
+    /// The next height to be released.
+    uint64_t next_height() const;
+
+    /// The highest buffered height (or the last released if empty).
+    uint64_t top_height() const;
+
+    /**
+     * Add a block to the buffer.
+     * @param[in]   height     The height of the block.
+     * @param[in]   block      The block.
+     * @param[in]   node       The channel from which the block was received.
+     * @return False if the height was already released or buffered.
+     */
+    bool push(uint64_t height, const chain::block& block,
+        network::channel::ptr node);
+
+    /**
+     * Remove the block at the next height, if it has been buffered.
+     * @param[out]  out_block      The block.
+     * @param[out]  out_node       The channel that provided the block.
+     * @return False if the block at the next height is not buffered.
+     */
+    bool pop(chain::block& out_block, network::channel::ptr& out_node);
+
+    /**
+     * Discard the blocks above a height, which have been replaced, and
+     * release from above the height again.
+     * @param[in]   height  The height of the last block retained.
+     */
+    void truncate(uint64_t height);
+
+private:
+    struct entry
+    {
+        chain::block block;
+        network::channel::ptr node;
+        size_t size;
+    };
+
+    typedef std::map<uint64_t, entry> block_map;
+
+    const size_t capacity_;
+    size_t bytes_;
+    uint64_t next_height_;
+    block_map blocks_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
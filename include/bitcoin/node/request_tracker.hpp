@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_REQUEST_TRACKER_HPP
+#define LIBBITCOIN_NODE_REQUEST_TRACKER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/**
+ * A thread safe table of outstanding data requests across all channels.
+ * Each hash is requested from at most one channel at a time, and each
+ * request has its own deadline. Requests that are not answered by their
+ * deadline are removed and passed to the expiry handler so that they may be
+ * requested from another channel.
+ */
+class BCN_API request_tracker
+{
+public:
+    typedef std::function<void(const hash_digest&, network::channel::ptr)>
+        expiry_handler;
+    typedef std::chrono::milliseconds duration;
+
+    request_tracker(threadpool& pool, uint32_t timeout_seconds);
+
+    /// This class is not copyable.
+    request_tracker(const request_tracker&) = delete;
+    void operator=(const request_tracker&) = delete;
+
+    /// Start periodic expiration of requests.
+    void start(expiry_handler handler);
+
+    /// Stop expiration of requests.
+    void stop();
+
+    /// Register a request with the default timeout, false if the hash is
+    /// already in flight.
+    bool request(const hash_digest& hash, network::channel::ptr node);
+
+    /**
+     * Register a request with its own timeout.
+     * @param[in]   hash     The hash of the requested object.
+     * @param[in]   node     The channel of the request.
+     * @param[in]   timeout  The time allowed for the response.
+     * @return False if the hash is already in flight.
+     */
+    bool request(const hash_digest& hash, network::channel::ptr node,
+        const duration& timeout);
+
+    /// The hash is in flight from some channel.
+    bool requested(const hash_digest& hash) const;
+
+    /// Remove a request that has been answered, false if not in flight.
+    bool complete(const hash_digest& hash);
+
+    /// Remove a request of the channel, false if not in flight from it.
+    bool complete(const hash_digest& hash, network::channel::ptr node);
+
+    /// Remove and return all requests in flight from the channel.
+    hash_list release(network::channel::ptr node);
+
+    /// The number of requests in flight.
+    size_t size() const;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct entry
+    {
+        network::channel::ptr node;
+        clock::time_point deadline;
+    };
+
+    typedef std::unordered_map<hash_digest, entry> request_map;
+
+    void start_timer();
+    void handle_timer(const code& ec);
+
+    threadpool& pool_;
+    const clock::duration timeout_;
+    expiry_handler handle_expiry_;
+    deadline::ptr timer_;
+    request_map requests_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
@@ -20,9 +20,21 @@
 #ifndef LIBBITCOIN_NODE_RESPONDER_HPP
 #define LIBBITCOIN_NODE_RESPONDER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <system_error>
+#include <unordered_map>
+#include <vector>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/block_cache.hpp>
+#include <bitcoin/node/bloom_filter.hpp>
+#include <bitcoin/node/chain_index.hpp>
 #include <bitcoin/node/define.hpp>
+#include <bitcoin/node/raw_block.hpp>
+#include <bitcoin/node/sync_state.hpp>
 
 namespace libbitcoin {
 namespace node {
@@ -30,32 +42,146 @@ namespace node {
 class BCN_API responder
 {
 public:
-    responder(blockchain::block_chain& chain,
-        blockchain::transaction_pool& tx_pool);
+    responder(blockchain::block_chain& chain, chain_index& index,
+        sync_state& sync, blockchain::transaction_pool& tx_pool,
+        uint32_t block_cache_megabytes);
 
     void monitor(network::channel::ptr node);
 
+    /// Cache new blocks, which most peers will soon request.
+    void cache(const blockchain::block_chain::list& blocks);
+
+    /// The channel has loaded a bloom filter (BIP37).
+    bool filtered(network::channel::ptr node) const;
+
+    /**
+     * Announce the chain top to the channel once it has been sent the block,
+     * the last of a full get blocks response, so that a peer synchronizing by
+     * get blocks asks for the next blocks (hashContinue).
+     * @param[in]   node  The channel.
+     * @param[in]   hash  The hash of the last block of the response.
+     */
+    void set_continuation(network::channel::ptr node,
+        const hash_digest& hash);
+
+    /**
+     * Match a transaction against the bloom filter loaded by the channel,
+     * which is updated by a match.
+     * @param[in]   node  The channel.
+     * @param[in]   tx    The transaction.
+     * @param[in]   hash  The hash of the transaction.
+     * @return True if the channel has no filter or the filter matches.
+     */
+    bool match(network::channel::ptr node, const chain::transaction& tx,
+        const hash_digest& hash);
+
 private:
+    enum class reply_state
+    {
+        pending,
+        found,
+        missing,
+        ignored
+    };
+
+    struct reply
+    {
+        message::inventory_vector inventory;
+        reply_state state;
+        chain::transaction tx;
+        raw_block::ptr block;
+        std::shared_ptr<const chain::block> filtered;
+    };
+
+    // The bloom filter loaded by a channel, which is updated as it matches.
+    struct peer_filter
+    {
+        typedef std::shared_ptr<peer_filter> ptr;
+
+        peer_filter(bloom_filter&& filter);
+
+        bloom_filter filter;
+        std::mutex mutex;
+    };
+
+    typedef std::map<network::channel::ptr, peer_filter::ptr> filter_map;
+    typedef std::map<network::channel::ptr, hash_digest> continuation_map;
+
+    // A get data request, of which the replies are sent in request order.
+    struct data_request
+    {
+        typedef std::shared_ptr<data_request> ptr;
+
+        data_request(network::channel::ptr node,
+            const message::inventory_vector::list& inventories);
+
+        const network::channel::ptr node;
+        std::vector<reply> replies;
+        size_t next;
+        size_t dispatched;
+        bool dispatching;
+        message::not_found missing;
+        std::mutex mutex;
+    };
+
+    // A reply awaiting a block read, which is shared by concurrent requests
+    // for the same block.
+    struct block_waiter
+    {
+        data_request::ptr request;
+        size_t index;
+    };
+
+    typedef std::unordered_map<hash_digest, std::vector<block_waiter>>
+        block_fetch_map;
+
     void receive_get_data(const code& ec,
         const message::get_data& packet, network::channel::ptr node);
-    void send_pool_tx(const code& ec, const chain::transaction& tx,
-        const hash_digest& tx_hash, network::channel::ptr node);
-    void send_chain_tx(const code& ec, const chain::transaction& tx,
-        const hash_digest& tx_hash, network::channel::ptr node);
+    void dispatch(data_request::ptr request);
+    bool next_dispatch(data_request::ptr request, size_t& out_index);
+    void fetch_item(data_request::ptr request, size_t index);
+    void handle_pool_tx(const code& ec, const chain::transaction& tx,
+        data_request::ptr request, size_t index);
+    void handle_chain_tx(const code& ec, const chain::transaction& tx,
+        data_request::ptr request, size_t index);
+    void fetch_block(const hash_digest& hash, data_request::ptr request,
+        size_t index);
+    void handle_fetch_block(const code& ec, const chain::block& block,
+        const hash_digest& hash);
+    void handle_fetch_filtered(const code& ec, const chain::block& block,
+        data_request::ptr request, size_t index);
+
+    // Bloom filters (BIP37).
+    void receive_filter_load(const code& ec,
+        const message::filter_load& packet, network::channel::ptr node);
+    void receive_filter_add(const code& ec,
+        const message::filter_add& packet, network::channel::ptr node);
+    void receive_filter_clear(const code& ec,
+        const message::filter_clear& packet, network::channel::ptr node);
+    void handle_stop(const code& ec, network::channel::ptr node);
+    peer_filter::ptr find_filter(network::channel::ptr node) const;
+    void complete(data_request::ptr request, size_t index, reply_state state);
     void send_tx(const chain::transaction& tx, const hash_digest& hash,
         network::channel::ptr node);
-    void send_tx_not_found(const hash_digest& hash,
+    void send_raw_block(raw_block::ptr block, network::channel::ptr node);
+    void send_continuation(const hash_digest& hash,
         network::channel::ptr node);
-    void send_block(const code& ec, const chain::block& block,
-        const hash_digest& block_hash, network::channel::ptr node);
-    void send_block_not_found(const hash_digest& block_hash,
+    void send_filtered_block(const chain::block& block,
+        peer_filter::ptr filter, network::channel::ptr node);
+    void send_not_found(const message::not_found& packet,
         network::channel::ptr node);
-    void send_inventory_not_found(message::inventory_type_id inventory_type,
-        const hash_digest& hash, network::channel::ptr node,
-        network::proxy::result_handler handler);
 
     blockchain::block_chain& blockchain_;
+    chain_index& index_;
+    sync_state& sync_;
     blockchain::transaction_pool& tx_pool_;
+    block_cache cache_;
+    filter_map filters_;
+    mutable std::mutex filters_mutex_;
+    continuation_map continuations_;
+    std::mutex continuations_mutex_;
+    block_fetch_map block_fetches_;
+    std::mutex block_fetches_mutex_;
 };
 
 } // node
@@ -20,15 +20,24 @@
 #ifndef LIBBITCOIN_NODE_SESSION_HPP
 #define LIBBITCOIN_NODE_SESSION_HPP
 
-#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <set>
 #include <system_error>
+#include <unordered_map>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/announcer.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/configuration.hpp>
 #include <bitcoin/node/define.hpp>
 #include <bitcoin/node/poller.hpp>
+#include <bitcoin/node/pool_inventory.hpp>
+#include <bitcoin/node/request_tracker.hpp>
 #include <bitcoin/node/responder.hpp>
+#include <bitcoin/node/sync_state.hpp>
 
 namespace libbitcoin {
 namespace node {
@@ -37,12 +46,21 @@ class BCN_API session
 {
 public:
     session(threadpool& pool, network::p2p& protocol,
-        blockchain::block_chain& blockchain, poller& poller,
+        blockchain::block_chain& blockchain, chain_index& index,
+        poller& poller, sync_state& sync,
         blockchain::transaction_pool& transaction_pool,
-        responder& responder, size_t last_checkpoint_height);
+        pool_inventory& pool_inventory, responder& responder,
+        announcer& announcer,
+        const configuration& config);
 
     void start();
 
+    /// Stop expiration of transaction requests.
+    void stop();
+
+    /// A transaction has been received from a channel.
+    void received_tx(const hash_digest& hash);
+
 private:
     void new_channel(const code& ec, network::channel::ptr node);
 
@@ -54,24 +72,67 @@ private:
         network::channel::ptr node);
     void receive_get_blocks(const code& ec, const message::get_blocks& packet,
         network::channel::ptr node);
-    void new_tx_inventory(const hash_digest& hash, network::channel::ptr node);
-    void request_tx_data(const code& ec, const hash_digest& hash,
+    void send_block_inventory(const message::get_blocks& packet,
         network::channel::ptr node);
-    void new_block_inventory(const hash_digest& hash,
+    void receive_get_headers(const code& ec,
+        const message::get_headers& packet, network::channel::ptr node);
+    void handle_channel_stop(const code& ec, network::channel::ptr node);
+    void remove_channel(network::channel::ptr node);
+
+    // A get data request joined from the existence tests of an inventory.
+    // This is protected by ordered dispatch.
+    struct data_request
+    {
+        typedef std::shared_ptr<data_request> ptr;
+
+        message::get_data packet;
+        size_t pending;
+    };
+
+    void handle_tx_exists(const code& ec,
+        const message::inventory_vector& inventory, data_request::ptr request,
         network::channel::ptr node);
-    void request_block_data(const hash_digest& hash,
+    void add_inventory(const message::inventory_vector& inventory,
+        bool missing, data_request::ptr request, network::channel::ptr node);
+    void send_data_request(const message::get_data& packet,
         network::channel::ptr node);
-    void fetch_block_handler(const code& ec, const chain::block& block,
-        const hash_digest hash, network::channel::ptr node);
+
+    // Transaction requests.
+    void add_tx_announcer(const hash_digest& hash, network::channel::ptr node);
+    void remove_tx_announcers(const hash_digest& hash);
+    void receive_not_found(const code& ec, const message::not_found& packet,
+        network::channel::ptr node);
+    void handle_tx_expired(const hash_digest& hash,
+        network::channel::ptr node);
+    void request_tx_fallback(const hash_digest& hash);
+
+    // Memory pool requests.
+    void receive_memory_pool(const code& ec,
+        const message::memory_pool& packet, network::channel::ptr node);
+    void add_mempool_peer(network::channel::ptr node);
+    void request_mempools();
 
     dispatcher dispatch_;
     network::p2p& network_;
     blockchain::block_chain& blockchain_;
+    node::chain_index& index_;
     blockchain::transaction_pool& tx_pool_;
+    node::pool_inventory& pool_inventory_;
     node::poller& poller_;
+    node::sync_state& sync_;
     node::responder& responder_;
-    std::atomic<uint64_t> last_height_;
-    size_t last_checkpoint_height_;
+    node::announcer& announcer_;
+    request_tracker tx_tracker_;
+    const bool request_mempool_;
+
+    // The other channels that announced each transaction in flight, in order
+    // of announcement. This is protected by ordered dispatch.
+    std::unordered_map<hash_digest, std::deque<network::channel::ptr>>
+        tx_announcers_;
+
+    // The channels yet to be asked for their memory pool once synced. This
+    // is protected by ordered dispatch.
+    std::set<network::channel::ptr> mempool_peers_;
 
     // HACK: this is for access to handle_new_blocks to facilitate server
     // inheritance of full_node. The organization should be refactored.
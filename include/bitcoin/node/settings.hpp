@@ -31,12 +31,40 @@ namespace node {
 #define NODE_THREADS                        4
 #define NODE_TRANSACTION_POOL_CAPACITY      2000
 #define NODE_PEERS                          config::endpoint::list()
+#define NODE_HEADERS_FIRST                  true
+#define NODE_BLOCKS_PER_REQUEST             128
+#define NODE_BLOCK_TIMEOUT_SECONDS          30
+#define NODE_BLOCK_MINIMUM_TIMEOUT_SECONDS  5
+#define NODE_BLOCK_STALL_LIMIT              3
+#define NODE_BLOCK_BUFFER_MEGABYTES         256
+#define NODE_STATISTICS_INTERVAL_SECONDS    30
+#define NODE_RELAY_TRICKLE_MILLISECONDS     2000
+#define NODE_TRANSACTION_TIMEOUT_SECONDS    10
+#define NODE_SYNC_TIP_AGE_MINUTES           1440
+#define NODE_BLOCK_ANNOUNCE_MILLISECONDS    250
+#define NODE_REQUEST_MEMPOOL                true
+#define NODE_BLOCK_CACHE_MEGABYTES          32
+#define NODE_COMPACT_FILTERS                false
 
 struct BCN_API settings
 {
     uint32_t threads;
     uint32_t transaction_pool_capacity;
     config::endpoint::list peers;
+    bool headers_first;
+    uint32_t blocks_per_request;
+    uint32_t block_timeout_seconds;
+    uint32_t block_minimum_timeout_seconds;
+    uint32_t block_stall_limit;
+    uint32_t block_buffer_megabytes;
+    uint32_t statistics_interval_seconds;
+    uint32_t relay_trickle_milliseconds;
+    uint32_t transaction_timeout_seconds;
+    uint32_t sync_tip_age_minutes;
+    uint32_t block_announce_milliseconds;
+    bool request_mempool;
+    uint32_t block_cache_megabytes;
+    bool compact_filters;
 };
 
 } // namespace node
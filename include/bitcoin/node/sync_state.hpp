@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_SYNC_STATE_HPP
+#define LIBBITCOIN_NODE_SYNC_STATE_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+#define LOG_SYNC "sync"
+
+/**
+ * The synchronization state of the node relative to the network.
+ * initial_download: the chain is below the last checkpoint or its top block
+ *     is old; mempool and relay work is not performed.
+ * catching_up: the chain is recent but behind the best known height.
+ * synced: the chain is within tolerance of the best known height.
+ */
+enum class sync_status
+{
+    initial_download,
+    catching_up,
+    synced
+};
+
+/**
+ * Thread safe tracking of the synchronization state of the node. The best
+ * known height is the greater of the top of the header queue and the median
+ * height advertised by connected peers (so that a single peer cannot hold
+ * the node in catch up). The initial download state is latched off once the
+ * node leaves it, as a top block that ages while the network is quiet does
+ * not mean that the node has fallen behind. The state is evaluated as its
+ * inputs change, and transitions are logged.
+ */
+class BCN_API sync_state
+{
+public:
+    sync_state(uint64_t last_checkpoint_height, uint32_t tip_age_minutes);
+
+    /// This class is not copyable.
+    sync_state(const sync_state&) = delete;
+    void operator=(const sync_state&) = delete;
+
+    /**
+     * Set the top of the local chain.
+     * @param[in]   height     The height of the top block.
+     * @param[in]   timestamp  The timestamp of the top block.
+     */
+    void set_top(uint64_t height, uint32_t timestamp);
+
+    /// Set the height of the last validated header.
+    void set_target(uint64_t height);
+
+    /// Record the start height advertised by a channel.
+    void add_peer(network::channel::ptr node, uint64_t height);
+
+    /// Forget the channel.
+    void remove_peer(network::channel::ptr node);
+
+    /// The height of the top of the local chain.
+    uint64_t top_height() const;
+
+    /// The best known height of the network chain.
+    uint64_t target_height() const;
+
+    /// The current state.
+    sync_status status() const;
+
+    /// The node is neither in initial download nor catching up.
+    bool synced() const;
+
+    /// The node is in initial download.
+    bool initial_download() const;
+
+private:
+    typedef std::map<network::channel::ptr, uint64_t> height_map;
+
+    // Caller must hold the mutex.
+    uint64_t target() const;
+    void update();
+
+    const uint64_t last_checkpoint_height_;
+    const uint32_t tip_age_seconds_;
+    uint64_t top_height_;
+    uint32_t top_timestamp_;
+    uint64_t header_height_;
+    height_map peer_heights_;
+    bool downloaded_;
+    sync_status status_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_NODE_SYNC_STATISTICS_HPP
+#define LIBBITCOIN_NODE_SYNC_STATISTICS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/define.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+/// A snapshot of block synchronization progress and throughput.
+struct BCN_API sync_progress
+{
+    uint64_t height;
+    uint64_t target_height;
+    double blocks_per_second;
+    double transactions_per_second;
+    double bytes_per_second;
+    uint32_t store_p50_milliseconds;
+    uint32_t store_p90_milliseconds;
+    uint32_t store_p99_milliseconds;
+    // The number of blocks accepted as orphans since startup.
+    uint64_t orphaned_total;
+    size_t in_flight;
+    uint64_t eta_seconds;
+};
+
+/**
+ * Thread safe rolling statistics of block synchronization. Counters are
+ * accumulated as blocks are downloaded and stored, and rates are computed
+ * over the interval between samples. Store latency percentiles are taken
+ * over a window of the most recent stores.
+ */
+class BCN_API sync_statistics
+{
+public:
+    sync_statistics();
+
+    /// This class is not copyable.
+    sync_statistics(const sync_statistics&) = delete;
+    void operator=(const sync_statistics&) = delete;
+
+    /// Record the receipt of a requested block.
+    void downloaded(uint64_t bytes);
+
+    /**
+     * Record a block confirmed into the chain.
+     * @param[in]   height        The height of the block.
+     * @param[in]   transactions  The number of transactions in the block.
+     * @param[in]   latency       The time taken to store the block.
+     */
+    void stored(uint64_t height, size_t transactions,
+        const std::chrono::milliseconds& latency);
+
+    /// Record a block accepted as an orphan.
+    void orphaned();
+
+    /**
+     * Compute rates since the previous sample.
+     * @param[in]   in_flight      The number of block requests in flight.
+     * @param[in]   target_height  The height being synchronized to.
+     * @return The new snapshot.
+     */
+    sync_progress sample(size_t in_flight, uint64_t target_height);
+
+    /// The snapshot of the most recent sample.
+    sync_progress progress() const;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    // Caller must hold the mutex.
+    uint32_t percentile(size_t percent) const;
+
+    uint64_t height_;
+    uint64_t blocks_;
+    uint64_t transactions_;
+    uint64_t bytes_;
+    uint64_t orphaned_total_;
+    uint64_t sampled_blocks_;
+    uint64_t sampled_transactions_;
+    uint64_t sampled_bytes_;
+    clock::time_point sampled_;
+    std::deque<uint32_t> latencies_;
+    sync_progress progress_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace node
+} // namespace libbitcoin
+
+#endif
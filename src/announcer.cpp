@@ -0,0 +1,433 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/announcer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/inventory_filter.hpp>
+#include <bitcoin/node/responder.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::message;
+using namespace bc::network;
+using std::placeholders::_1;
+using std::placeholders::_2;
+
+// The number of recent inventory hashes remembered for each channel.
+static constexpr size_t known_inventory = 10000;
+
+// The maximum number of inventories in a relay batch.
+static constexpr size_t max_relay_batch = 1000;
+
+// More new blocks than this are announced by inventory, as the peer is
+// unlikely to connect a long run of headers (as bitcoind).
+static constexpr size_t max_header_announcement = 8;
+
+// The number of recent blocks retained for the next announcement.
+static constexpr size_t max_announce_blocks = 500;
+
+announcer::peer::peer(size_t capacity, bool relay)
+  : known(capacity), headers(false), relay(relay)
+{
+}
+
+announcer::announcer(threadpool& pool, responder& responder,
+    uint32_t trickle_milliseconds, uint32_t announce_milliseconds)
+  : pool_(pool),
+    responder_(responder),
+    trickle_milliseconds_(trickle_milliseconds),
+    announce_milliseconds_(announce_milliseconds),
+    stopped_(false)
+{
+}
+
+void announcer::monitor(channel::ptr node)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        peers_.emplace(node, peer(known_inventory, node->version().relay));
+    }
+
+    node->subscribe<inventory>(
+        std::bind(&announcer::receive_inventory,
+            this, _1, _2, node));
+
+    node->subscribe<block>(
+        std::bind(&announcer::receive_block,
+            this, _1, _2, node));
+
+    node->subscribe<send_headers>(
+        std::bind(&announcer::receive_send_headers,
+            this, _1, _2, node));
+
+    node->subscribe_stop(
+        std::bind(&announcer::handle_stop,
+            this, _1, node));
+}
+
+void announcer::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+
+    for (const auto& entry: peers_)
+        if (entry.second.timer)
+            entry.second.timer->stop();
+
+    if (announce_timer_)
+        announce_timer_->stop();
+}
+
+void announcer::receive_inventory(const code& ec, const inventory& packet,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    mark(node, packet.inventories);
+
+    node->subscribe<inventory>(
+        std::bind(&announcer::receive_inventory,
+            this, _1, _2, node));
+}
+
+void announcer::receive_block(const code& ec, const block& block,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    mark(node, { { inventory_type_id::block, block.header.hash() } });
+
+    node->subscribe<message::block>(
+        std::bind(&announcer::receive_block,
+            this, _1, _2, node));
+}
+
+// The peer prefers new blocks announced by headers (BIP130).
+void announcer::receive_send_headers(const code& ec, const send_headers&,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = peers_.find(node);
+
+    if (it != peers_.end())
+        it->second.headers = true;
+}
+
+void announcer::handle_stop(const code&, channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = peers_.find(node);
+
+    if (it == peers_.end())
+        return;
+
+    if (it->second.timer)
+        it->second.timer->stop();
+
+    peers_.erase(it);
+}
+
+void announcer::mark(channel::ptr node,
+    const inventory_vector::list& inventories)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = peers_.find(node);
+
+    if (it == peers_.end())
+        return;
+
+    for (const auto& inventory: inventories)
+        it->second.known.insert(inventory.hash);
+}
+
+size_t announcer::announce(channel::ptr node, const inventory& packet)
+{
+    inventory filtered;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = peers_.find(node);
+
+        if (it != peers_.end())
+            filtered = filter(it->second, packet.inventories);
+    }
+
+    if (!filtered.inventories.empty())
+        send(node, filtered);
+
+    return filtered.inventories.size();
+}
+
+void announcer::relay(const chain::transaction& tx, const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (stopped_)
+        return;
+
+    for (auto& entry: peers_)
+    {
+        const auto& node = entry.first;
+        auto& peer = entry.second;
+
+        // The peer that announced the transaction is not sent it.
+        if (peer.known.contains(hash))
+            continue;
+
+        // A peer that declined relay is sent nothing until it loads a filter.
+        if (!peer.relay && !responder_.filtered(node))
+            continue;
+
+        // Matching updates the filter, so it is done once, as queued.
+        if (!responder_.match(node, tx, hash))
+            continue;
+
+        peer.pending.push_back({ inventory_type_id::transaction, hash });
+
+        if (!peer.timer)
+            start_trickle(entry.first, peer);
+    }
+}
+
+// The random delay obscures the origin of relayed inventory and batches it.
+void announcer::start_trickle(channel::ptr node, peer& peer)
+{
+    const auto span = 2 * static_cast<uint64_t>(trickle_milliseconds_) + 1;
+    const auto delay = boost::posix_time::milliseconds(
+        pseudo_random() % span);
+
+    peer.timer = std::make_shared<deadline>(pool_, delay);
+    peer.timer->start(
+        std::bind(&announcer::handle_trickle,
+            this, _1, node));
+}
+
+void announcer::handle_trickle(const code& ec, channel::ptr node)
+{
+    // The timer has been stopped.
+    if (ec)
+        return;
+
+    inventory batch;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = peers_.find(node);
+
+        if (it == peers_.end())
+            return;
+
+        auto& peer = it->second;
+        auto& pending = peer.pending;
+        const auto count = std::min(pending.size(), max_relay_batch);
+        const inventory_vector::list next(pending.begin(),
+            pending.begin() + count);
+
+        pending.erase(pending.begin(), pending.begin() + count);
+        batch = filter(peer, next);
+        peer.timer.reset();
+
+        // Inventory beyond the batch limit waits for the next trickle.
+        if (!pending.empty() && !stopped_)
+            start_trickle(node, peer);
+    }
+
+    if (!batch.inventories.empty())
+        send(node, batch);
+}
+
+void announcer::announce_blocks(const chain::header::list& headers)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (stopped_ || headers.empty())
+        return;
+
+    // Drop queued blocks above the fork point of a reorganization.
+    const auto& parent = headers.front().previous_block_hash;
+    const auto fork = std::find_if(blocks_.rbegin(), blocks_.rend(),
+        [&parent](const chain::header& block)
+        {
+            return block.hash() == parent;
+        });
+
+    blocks_.erase(fork.base(), blocks_.end());
+    blocks_.insert(blocks_.end(), headers.begin(), headers.end());
+
+    if (blocks_.size() > max_announce_blocks)
+        blocks_.erase(blocks_.begin(),
+            blocks_.end() - max_announce_blocks);
+
+    if (announce_timer_)
+        return;
+
+    // Blocks that arrive within the window join this announcement.
+    announce_timer_ = std::make_shared<deadline>(pool_,
+        boost::posix_time::milliseconds(announce_milliseconds_));
+    announce_timer_->start(
+        std::bind(&announcer::handle_announce,
+            this, _1));
+}
+
+void announcer::handle_announce(const code& ec)
+{
+    // The timer has been stopped.
+    if (ec)
+        return;
+
+    typedef std::pair<channel::ptr, inventory> block_inventory;
+    typedef std::pair<channel::ptr, message::headers> block_headers;
+    std::vector<block_inventory> inventories;
+    std::vector<block_headers> headers;
+
+    // Filter under the lock, send outside of it.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto blocks = std::move(blocks_);
+        blocks_.clear();
+        announce_timer_.reset();
+
+        for (auto& entry: peers_)
+        {
+            auto& peer = entry.second;
+            message::headers unknown_headers;
+            inventory unknown_inventory;
+            select_blocks(peer.known, peer.headers, blocks, unknown_headers,
+                unknown_inventory);
+
+            if (!unknown_headers.elements.empty())
+                headers.push_back(std::make_pair(entry.first,
+                    unknown_headers));
+            else if (!unknown_inventory.inventories.empty())
+                inventories.push_back(std::make_pair(entry.first,
+                    unknown_inventory));
+        }
+    }
+
+    for (const auto& announcement: headers)
+        send(announcement.first, announcement.second);
+
+    for (const auto& announcement: inventories)
+        send(announcement.first, announcement.second);
+
+    log::debug(LOG_SESSION)
+        << "Announced blocks by headers to (" << headers.size()
+        << ") and by inventory to (" << inventories.size() << ") channels.";
+}
+
+void announcer::select_blocks(inventory_filter& known, bool headers,
+    const chain::header::list& blocks, message::headers& out_headers,
+    inventory& out_inventory)
+{
+    message::headers unknown;
+
+    for (const auto& block: blocks)
+        if (!known.contains(block.hash()))
+            unknown.elements.push_back(block);
+
+    if (unknown.elements.empty())
+        return;
+
+    // Headers must connect to a block that the peer has.
+    const auto& parent = unknown.elements.front().previous_block_hash;
+    const auto connects = known.contains(parent);
+
+    if (headers && connects &&
+        unknown.elements.size() <= max_header_announcement)
+    {
+        for (const auto& block: unknown.elements)
+            known.insert(block.hash());
+
+        out_headers = std::move(unknown);
+        return;
+    }
+
+    for (const auto& block: unknown.elements)
+    {
+        const auto hash = block.hash();
+
+        if (known.contains(hash))
+            continue;
+
+        known.insert(hash);
+        out_inventory.inventories.push_back(
+            { inventory_type_id::block, hash });
+    }
+}
+
+inventory announcer::filter(peer& peer,
+    const inventory_vector::list& inventories)
+{
+    inventory filtered;
+
+    for (const auto& inventory: inventories)
+    {
+        if (peer.known.contains(inventory.hash))
+            continue;
+
+        peer.known.insert(inventory.hash);
+        filtered.inventories.push_back(inventory);
+    }
+
+    return filtered;
+}
+
+void announcer::send(channel::ptr node, const inventory& packet)
+{
+    const auto handle_send = [node](const code ec)
+    {
+        if (ec)
+            log::debug(LOG_SESSION)
+                << "Failure sending inventory to [" << node->authority()
+                << "] " << ec.message();
+    };
+
+    node->send(packet, handle_send);
+}
+
+void announcer::send(channel::ptr node, const message::headers& packet)
+{
+    const auto handle_send = [node](const code ec)
+    {
+        if (ec)
+            log::debug(LOG_SESSION)
+                << "Failure sending headers to [" << node->authority()
+                << "] " << ec.message();
+    };
+
+    node->send(packet, handle_send);
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/block_cache.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/raw_block.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+block_cache::block_cache(size_t maximum_bytes)
+  : maximum_bytes_(maximum_bytes), bytes_(0)
+{
+}
+
+void block_cache::store(raw_block::ptr block)
+{
+    const auto size = block->satoshi_size();
+
+    if (size > maximum_bytes_)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(block->hash());
+
+    // Refreshing a cached block moves it to the front.
+    if (it != index_.end())
+    {
+        blocks_.splice(blocks_.begin(), blocks_, it->second);
+        return;
+    }
+
+    while (!blocks_.empty() && bytes_ + size > maximum_bytes_)
+    {
+        const auto& oldest = blocks_.back();
+        bytes_ -= oldest->satoshi_size();
+        index_.erase(oldest->hash());
+        blocks_.pop_back();
+    }
+
+    blocks_.push_front(block);
+    index_[block->hash()] = blocks_.begin();
+    bytes_ += size;
+}
+
+raw_block::ptr block_cache::find(const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(hash);
+
+    if (it == index_.end())
+        return nullptr;
+
+    blocks_.splice(blocks_.begin(), blocks_, it->second);
+    return *it->second;
+}
+
+size_t block_cache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size();
+}
+
+size_t block_cache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/bloom_filter.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::chain;
+
+// The multiplier of the hash function index in the hash seed (BIP37).
+static constexpr uint32_t seed_multiplier = 0xfba4c795;
+
+constexpr size_t bloom_filter::max_filter_bytes;
+constexpr uint32_t bloom_filter::max_hash_functions;
+constexpr size_t bloom_filter::max_element_bytes;
+
+static inline uint32_t rotate_left(uint32_t value, uint32_t bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// The 32 bit murmur3 hash, as specified for connection bloom filters.
+static uint32_t murmur3_32(data_slice data, uint32_t seed)
+{
+    static constexpr uint32_t c1 = 0xcc9e2d51;
+    static constexpr uint32_t c2 = 0x1b873593;
+
+    const auto bytes = data.data();
+    const auto size = data.size();
+    const auto blocks = size / 4;
+    auto hash = seed;
+
+    for (size_t block = 0; block < blocks; ++block)
+    {
+        const auto word = bytes + block * 4;
+        auto value = uint32_t(word[0]) | uint32_t(word[1]) << 8 |
+            uint32_t(word[2]) << 16 | uint32_t(word[3]) << 24;
+
+        value *= c1;
+        value = rotate_left(value, 15);
+        value *= c2;
+        hash ^= value;
+        hash = rotate_left(hash, 13);
+        hash = hash * 5 + 0xe6546b64;
+    }
+
+    const auto tail = bytes + blocks * 4;
+    uint32_t value = 0;
+
+    switch (size & 3)
+    {
+        case 3:
+            value ^= uint32_t(tail[2]) << 16;
+            // fall through
+        case 2:
+            value ^= uint32_t(tail[1]) << 8;
+            // fall through
+        case 1:
+            value ^= tail[0];
+            value *= c1;
+            value = rotate_left(value, 15);
+            value *= c2;
+            hash ^= value;
+    }
+
+    hash ^= static_cast<uint32_t>(size);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// A serialized output point, as inserted into the filter by updates.
+static byte_array<36> serialize(const output_point& point)
+{
+    byte_array<36> data;
+    std::copy(point.hash.begin(), point.hash.end(), data.begin());
+
+    for (size_t byte = 0; byte < 4; ++byte)
+        data[32 + byte] = static_cast<uint8_t>(point.index >> (8 * byte));
+
+    return data;
+}
+
+// Pay to public key or bare multisig, whose spends contain no data element
+// of the output, so must be matched by output point.
+static bool is_pubkey_script(const script& script)
+{
+    const auto& operations = script.operations;
+
+    if (operations.empty())
+        return false;
+
+    const auto code = operations.back().code;
+    return (code == opcode::checksig && operations.size() == 2) ||
+        code == opcode::checkmultisig;
+}
+
+bloom_filter::bloom_filter(const data_chunk& data, uint32_t hash_functions,
+    uint32_t tweak, uint8_t flags)
+  : data_(data),
+    hash_functions_(hash_functions),
+    tweak_(tweak),
+    flags_(flags),
+    full_(false),
+    empty_(false)
+{
+    update_state();
+}
+
+bloom_filter::bloom_filter(size_t elements, double false_positive_rate,
+    uint32_t tweak, uint8_t flags)
+  : tweak_(tweak),
+    flags_(flags),
+    full_(false),
+    empty_(true)
+{
+    static const auto ln2 = std::log(2.0);
+    const auto count = static_cast<double>(std::max(elements, size_t(1)));
+    const auto bits = -count * std::log(false_positive_rate) / (ln2 * ln2);
+    const auto bytes = std::min(bits, max_filter_bytes * 8.0) / 8;
+    data_.resize(static_cast<size_t>(bytes), 0);
+
+    const auto functions = data_.size() * 8 / count * ln2;
+    hash_functions_ = static_cast<uint32_t>(std::min(functions,
+        static_cast<double>(max_hash_functions)));
+}
+
+bool bloom_filter::is_valid() const
+{
+    return data_.size() <= max_filter_bytes &&
+        hash_functions_ <= max_hash_functions;
+}
+
+const data_chunk& bloom_filter::data() const
+{
+    return data_;
+}
+
+uint32_t bloom_filter::hash_functions() const
+{
+    return hash_functions_;
+}
+
+uint32_t bloom_filter::position(data_slice element, uint32_t function) const
+{
+    const auto seed = function * seed_multiplier + tweak_;
+    return murmur3_32(element, seed) % (data_.size() * 8);
+}
+
+void bloom_filter::insert(data_slice element)
+{
+    if (full_ || data_.empty())
+        return;
+
+    for (uint32_t function = 0; function < hash_functions_; ++function)
+    {
+        const auto bit = position(element, function);
+        data_[bit >> 3] |= uint8_t(1) << (bit & 7);
+    }
+
+    empty_ = false;
+}
+
+bool bloom_filter::contains(data_slice element) const
+{
+    if (full_)
+        return true;
+
+    if (empty_)
+        return false;
+
+    for (uint32_t function = 0; function < hash_functions_; ++function)
+    {
+        const auto bit = position(element, function);
+
+        if ((data_[bit >> 3] & (uint8_t(1) << (bit & 7))) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool bloom_filter::match(const transaction& tx, const hash_digest& hash)
+{
+    if (full_)
+        return true;
+
+    if (empty_)
+        return false;
+
+    auto matched = contains(hash);
+    const auto update = flags_ & update_mask;
+
+    // Outputs are tested in full, so that each matched output is inserted.
+    for (uint32_t index = 0; index < tx.outputs.size(); ++index)
+    {
+        const auto& script = tx.outputs[index].script;
+
+        for (const auto& operation: script.operations)
+        {
+            if (operation.data.empty() || !contains(operation.data))
+                continue;
+
+            matched = true;
+
+            if (update == update_all ||
+                (update == update_p2pubkey_only && is_pubkey_script(script)))
+                insert(serialize({ hash, index }));
+
+            break;
+        }
+    }
+
+    if (matched)
+        return true;
+
+    for (const auto& input: tx.inputs)
+    {
+        if (contains(serialize(input.previous_output)))
+            return true;
+
+        for (const auto& operation: input.script.operations)
+            if (!operation.data.empty() && contains(operation.data))
+                return true;
+    }
+
+    return false;
+}
+
+void bloom_filter::update_state()
+{
+    full_ = !data_.empty() && std::all_of(data_.begin(), data_.end(),
+        [](uint8_t byte) { return byte == 0xff; });
+    empty_ = std::all_of(data_.begin(), data_.end(),
+        [](uint8_t byte) { return byte == 0; });
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,391 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/chain_index.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::blockchain;
+using namespace bc::chain;
+using namespace bc::message;
+using std::placeholders::_1;
+using std::placeholders::_2;
+using std::placeholders::_3;
+using std::placeholders::_4;
+
+// The number of top hashes in a locator before the step starts doubling.
+static constexpr size_t locator_dense_hashes = 10;
+
+// The number of headers fetched concurrently while loading.
+static constexpr uint64_t load_batch_size = 1000;
+
+chain_index::chain_index(block_chain& chain)
+  : blockchain_(chain)
+{
+}
+
+void chain_index::start(uint64_t height, result_handler handler)
+{
+    blockchain_.subscribe_reorganize(
+        std::bind(&chain_index::handle_reorganize,
+            this, _1, _2, _3, _4));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hashes_.reserve(height + 1);
+        headers_.reserve(height + 1);
+    }
+
+    load(height, handler);
+}
+
+// Load the next batch above the index, which may have been changed by a
+// reorganization since the last batch.
+void chain_index::load(uint64_t top, result_handler handler)
+{
+    const auto start = size();
+
+    // The chain may have grown during loading.
+    if (start > top)
+    {
+        blockchain_.fetch_last_height(
+            std::bind(&chain_index::handle_fetch_height,
+                this, _1, _2, handler));
+        return;
+    }
+
+    const auto count = std::min(top - start + 1, load_batch_size);
+    const auto headers = std::make_shared<batch>();
+    headers->start = start;
+    headers->headers.resize(count);
+    headers->remaining = count;
+
+    for (auto height = start; height < start + count; ++height)
+        blockchain_.fetch_block_header(height,
+            std::bind(&chain_index::handle_fetch_header,
+                this, _1, _2, height, top, headers, handler));
+}
+
+void chain_index::handle_fetch_height(const code& ec, uint64_t top,
+    result_handler handler)
+{
+    if (ec)
+    {
+        handler(ec);
+        return;
+    }
+
+    // Later blocks are applied by their reorganization notifications.
+    if (top < size())
+    {
+        handler(error::success);
+        return;
+    }
+
+    load(top, handler);
+}
+
+void chain_index::handle_fetch_header(const code& ec,
+    const chain::header& header, uint64_t height, uint64_t top,
+    batch::ptr headers, result_handler handler)
+{
+    {
+        std::lock_guard<std::mutex> lock(headers->mutex);
+
+        if (ec)
+            headers->result = ec;
+        else
+            headers->headers[height - headers->start] = header;
+
+        if (--headers->remaining > 0)
+            return;
+    }
+
+    if (headers->result)
+    {
+        handler(headers->result);
+        return;
+    }
+
+    bool linked;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        linked = link(headers->headers, headers->start);
+    }
+
+    if (linked)
+        load(top, handler);
+    else
+        verify(top, handler);
+}
+
+// The chain was reorganized while the batch was read, so indexed blocks that
+// are no longer in the chain are removed before loading resumes.
+void chain_index::verify(uint64_t top, result_handler handler)
+{
+    const auto count = size();
+
+    if (count == 0)
+    {
+        load(top, handler);
+        return;
+    }
+
+    blockchain_.fetch_block_header(count - 1,
+        std::bind(&chain_index::handle_verify,
+            this, _1, _2, count - 1, top, handler));
+}
+
+void chain_index::handle_verify(const code& ec, const chain::header& header,
+    uint64_t height, uint64_t top, result_handler handler)
+{
+    if (ec)
+    {
+        handler(ec);
+        return;
+    }
+
+    bool replaced;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replaced = hashes_.size() == height + 1 &&
+            hashes_.back() != header.hash();
+
+        if (replaced)
+            truncate(height);
+    }
+
+    if (replaced)
+        verify(top, handler);
+    else
+        load(top, handler);
+}
+
+void chain_index::handle_reorganize(const code& ec, uint64_t fork_point,
+    const block_chain::list& new_blocks, const block_chain::list&)
+{
+    if (ec == error::service_stopped)
+        return;
+
+    if (!ec)
+        reorganize(fork_point, new_blocks);
+
+    blockchain_.subscribe_reorganize(
+        std::bind(&chain_index::handle_reorganize,
+            this, _1, _2, _3, _4));
+}
+
+void chain_index::reorganize(uint64_t fork_point,
+    const block_chain::list& new_blocks)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Blocks above the fork point are replaced by the new blocks. Blocks
+    // above a loading index are instead read by the loader.
+    truncate(fork_point + 1);
+
+    if (hashes_.size() == fork_point + 1)
+        for (const auto block: new_blocks)
+            push(block->header);
+}
+
+uint64_t chain_index::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hashes_.size();
+}
+
+hash_digest chain_index::top_hash() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hashes_.empty() ? null_hash : hashes_.back();
+}
+
+bool chain_index::exists(const hash_digest& hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return heights_.find(hash) != heights_.end();
+}
+
+bool chain_index::find(uint64_t& out_height, const hash_digest& hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = heights_.find(hash);
+
+    if (it == heights_.end())
+        return false;
+
+    out_height = it->second;
+    return true;
+}
+
+bool chain_index::hash_at(hash_digest& out_hash, uint64_t height) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (height >= hashes_.size())
+        return false;
+
+    out_hash = hashes_[height];
+    return true;
+}
+
+uint64_t chain_index::fork_height(const block_locator& locator) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto& hash: locator)
+    {
+        const auto it = heights_.find(hash);
+
+        if (it != heights_.end())
+            return it->second;
+    }
+
+    return 0;
+}
+
+// Headers are stored serialized and are deserialized only to be served.
+header::list chain_index::headers(uint64_t start, const hash_digest& stop,
+    size_t limit) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    header::list headers;
+
+    for (auto height = start; height < headers_.size() &&
+        headers.size() < limit; ++height)
+    {
+        const auto& serialized = headers_[height];
+        const data_chunk data(serialized.begin(), serialized.end());
+
+        header header;
+        header.from_data(data, false);
+        header.transaction_count = 0;
+        headers.push_back(header);
+
+        if (hashes_[height] == stop)
+            break;
+    }
+
+    return headers;
+}
+
+hash_list chain_index::hashes(uint64_t start, const hash_digest& stop,
+    size_t limit) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hash_list hashes;
+
+    for (auto height = start; height < hashes_.size() &&
+        hashes.size() < limit && hashes_[height] != stop; ++height)
+        hashes.push_back(hashes_[height]);
+
+    return hashes;
+}
+
+// Dense from the top, then exponentially sparse, always ending at genesis.
+block_locator chain_index::locator() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    block_locator locator;
+
+    if (hashes_.empty())
+        return locator;
+
+    uint64_t step = 1;
+    auto height = static_cast<uint64_t>(hashes_.size() - 1);
+
+    while (true)
+    {
+        locator.push_back(hashes_[height]);
+
+        if (height == 0)
+            break;
+
+        if (locator.size() >= locator_dense_hashes)
+            step *= 2;
+
+        height = height > step ? height - step : 0;
+    }
+
+    return locator;
+}
+
+void chain_index::push(const header& header)
+{
+    const auto hash = header.hash();
+    const auto data = header.to_data(false);
+
+    header_bytes serialized;
+    BITCOIN_ASSERT(data.size() == serialized.size());
+    std::copy(data.begin(), data.end(), serialized.begin());
+
+    heights_[hash] = hashes_.size();
+    hashes_.push_back(hash);
+    headers_.push_back(serialized);
+}
+
+// Append the headers of a batch, skipping those already indexed. False if a
+// header differs from or does not link to the index.
+bool chain_index::link(const header::list& headers, uint64_t start)
+{
+    for (size_t index = 0; index < headers.size(); ++index)
+    {
+        const auto& header = headers[index];
+        const auto height = start + index;
+
+        if (height < hashes_.size())
+        {
+            if (hashes_[height] != header.hash())
+                return false;
+
+            continue;
+        }
+
+        if (height > hashes_.size() || (!hashes_.empty() &&
+            header.previous_block_hash != hashes_.back()))
+            return false;
+
+        push(header);
+    }
+
+    return true;
+}
+
+void chain_index::truncate(uint64_t size)
+{
+    while (hashes_.size() > size)
+    {
+        heights_.erase(hashes_.back());
+        hashes_.pop_back();
+        headers_.pop_back();
+    }
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,379 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/compact_filter.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::chain;
+
+// The first byte of a data carrier output script.
+static constexpr uint8_t op_return = 0x6a;
+
+constexpr uint8_t compact_filter::golomb_bits;
+constexpr uint64_t compact_filter::inverse_rate;
+
+static inline uint64_t rotate_left(uint64_t value, uint32_t bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read_word(const uint8_t* data, size_t size)
+{
+    uint64_t value = 0;
+
+    for (size_t byte = 0; byte < size; ++byte)
+        value |= uint64_t(data[byte]) << (8 * byte);
+
+    return value;
+}
+
+// The high word of the 128 bit product, which maps a hash onto a range.
+static uint64_t multiply_high(uint64_t left, uint64_t right)
+{
+    const auto left_low = left & 0xffffffff;
+    const auto left_high = left >> 32;
+    const auto right_low = right & 0xffffffff;
+    const auto right_high = right >> 32;
+
+    const auto low = left_low * right_low;
+    const auto middle1 = left_high * right_low + (low >> 32);
+    const auto middle2 = left_low * right_high + (middle1 & 0xffffffff);
+    return left_high * right_high + (middle1 >> 32) + (middle2 >> 32);
+}
+
+// The hashes of the elements mapped onto the range of the filter, sorted.
+static std::vector<uint64_t> hash_elements(const hash_digest& block_hash,
+    const compact_filter::element_list& elements, uint64_t count)
+{
+    const auto key0 = read_word(block_hash.data(), 8);
+    const auto key1 = read_word(block_hash.data() + 8, 8);
+    const auto range = count * compact_filter::inverse_rate;
+
+    std::vector<uint64_t> values;
+    values.reserve(elements.size());
+
+    for (const auto& element: elements)
+        values.push_back(multiply_high(
+            compact_filter::siphash(key0, key1, element), range));
+
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+// Writes bits most significant first.
+class bit_writer
+{
+public:
+    bit_writer(data_chunk& data)
+      : data_(data), offset_(8)
+    {
+    }
+
+    void write(uint64_t value, size_t bits)
+    {
+        while (bits-- > 0)
+        {
+            if (offset_ == 8)
+            {
+                data_.push_back(0);
+                offset_ = 0;
+            }
+
+            if (((value >> bits) & 1) != 0)
+                data_.back() |= uint8_t(0x80) >> offset_;
+
+            ++offset_;
+        }
+    }
+
+private:
+    data_chunk& data_;
+    size_t offset_;
+};
+
+// Reads bits most significant first, false at the end of the data.
+class bit_reader
+{
+public:
+    bit_reader(const data_chunk& data, size_t start)
+      : data_(data), position_(start * 8)
+    {
+    }
+
+    bool read(uint64_t& out_value, size_t bits)
+    {
+        if (position_ + bits > data_.size() * 8)
+            return false;
+
+        out_value = 0;
+
+        for (; bits > 0; --bits, ++position_)
+        {
+            const auto byte = data_[position_ / 8];
+            const auto bit = (byte >> (7 - position_ % 8)) & 1;
+            out_value = (out_value << 1) | bit;
+        }
+
+        return true;
+    }
+
+    bool read_unary(uint64_t& out_value)
+    {
+        out_value = 0;
+        uint64_t bit;
+
+        while (read(bit, 1))
+        {
+            if (bit == 0)
+                return true;
+
+            ++out_value;
+        }
+
+        return false;
+    }
+
+private:
+    const data_chunk& data_;
+    size_t position_;
+};
+
+static void write_variable(data_chunk& data, uint64_t value)
+{
+    size_t size = 0;
+
+    if (value < 0xfd)
+    {
+        data.push_back(static_cast<uint8_t>(value));
+        return;
+    }
+    else if (value <= 0xffff)
+    {
+        data.push_back(0xfd);
+        size = 2;
+    }
+    else if (value <= 0xffffffff)
+    {
+        data.push_back(0xfe);
+        size = 4;
+    }
+    else
+    {
+        data.push_back(0xff);
+        size = 8;
+    }
+
+    for (size_t byte = 0; byte < size; ++byte)
+        data.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+}
+
+static bool read_variable(uint64_t& out_value, size_t& out_size,
+    const data_chunk& data)
+{
+    if (data.empty())
+        return false;
+
+    const auto prefix = data.front();
+    out_size = prefix < 0xfd ? 1 : prefix == 0xfd ? 3 : prefix == 0xfe ? 5 : 9;
+
+    if (data.size() < out_size)
+        return false;
+
+    out_value = out_size == 1 ? prefix :
+        read_word(data.data() + 1, out_size - 1);
+    return true;
+}
+
+uint64_t compact_filter::siphash(uint64_t key0, uint64_t key1,
+    data_slice data)
+{
+    auto v0 = key0 ^ 0x736f6d6570736575;
+    auto v1 = key1 ^ 0x646f72616e646f6d;
+    auto v2 = key0 ^ 0x6c7967656e657261;
+    auto v3 = key1 ^ 0x7465646279746573;
+
+    const auto round = [&]()
+    {
+        v0 += v1;
+        v1 = rotate_left(v1, 13);
+        v1 ^= v0;
+        v0 = rotate_left(v0, 32);
+        v2 += v3;
+        v3 = rotate_left(v3, 16);
+        v3 ^= v2;
+        v0 += v3;
+        v3 = rotate_left(v3, 21);
+        v3 ^= v0;
+        v2 += v1;
+        v1 = rotate_left(v1, 17);
+        v1 ^= v2;
+        v2 = rotate_left(v2, 32);
+    };
+
+    const auto bytes = data.data();
+    const auto size = data.size();
+    const auto words = size / 8;
+
+    for (size_t word = 0; word < words; ++word)
+    {
+        const auto value = read_word(bytes + word * 8, 8);
+        v3 ^= value;
+        round();
+        round();
+        v0 ^= value;
+    }
+
+    const auto last = (uint64_t(size) << 56) |
+        read_word(bytes + words * 8, size % 8);
+    v3 ^= last;
+    round();
+    round();
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    round();
+    round();
+    round();
+    round();
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+compact_filter::element_list compact_filter::elements(const block& block,
+    const std::vector<script>& prevouts)
+{
+    element_list elements;
+
+    for (const auto& tx: block.transactions)
+    {
+        for (const auto& output: tx.outputs)
+        {
+            auto data = output.script.to_data(false);
+
+            if (!data.empty() && data.front() != op_return)
+                elements.push_back(std::move(data));
+        }
+    }
+
+    for (const auto& prevout: prevouts)
+    {
+        auto data = prevout.to_data(false);
+
+        if (!data.empty())
+            elements.push_back(std::move(data));
+    }
+
+    return elements;
+}
+
+data_chunk compact_filter::build(const hash_digest& block_hash,
+    const element_list& elements)
+{
+    auto unique = elements;
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+    data_chunk filter;
+    write_variable(filter, unique.size());
+
+    bit_writer writer(filter);
+    uint64_t previous = 0;
+
+    for (const auto value: hash_elements(block_hash, unique, unique.size()))
+    {
+        const auto delta = value - previous;
+        previous = value;
+
+        // The quotient in unary, then the remainder in fixed width.
+        for (auto quotient = delta >> golomb_bits; quotient > 0; --quotient)
+            writer.write(1, 1);
+
+        writer.write(0, 1);
+        writer.write(delta, golomb_bits);
+    }
+
+    return filter;
+}
+
+bool compact_filter::match(const data_chunk& filter,
+    const hash_digest& block_hash, data_slice element)
+{
+    return match_any(filter, block_hash,
+        { data_chunk(element.begin(), element.end()) });
+}
+
+// The sorted element hashes are merged against the decoded filter values.
+bool compact_filter::match_any(const data_chunk& filter,
+    const hash_digest& block_hash, const element_list& elements)
+{
+    uint64_t count;
+    size_t start;
+
+    if (elements.empty() || !read_variable(count, start, filter) ||
+        count == 0)
+        return false;
+
+    const auto targets = hash_elements(block_hash, elements, count);
+    auto target = targets.begin();
+
+    bit_reader reader(filter, start);
+    uint64_t value = 0;
+
+    for (uint64_t index = 0; index < count; ++index)
+    {
+        uint64_t quotient;
+        uint64_t remainder;
+
+        if (!reader.read_unary(quotient) ||
+            !reader.read(remainder, golomb_bits))
+            return false;
+
+        value += (quotient << golomb_bits) | remainder;
+
+        while (target != targets.end() && *target < value)
+            ++target;
+
+        if (target == targets.end())
+            return false;
+
+        if (*target == value)
+            return true;
+    }
+
+    return false;
+}
+
+hash_digest compact_filter::header(const data_chunk& filter,
+    const hash_digest& previous_header)
+{
+    const auto filter_hash = bitcoin_hash(filter);
+    data_chunk data(filter_hash.begin(), filter_hash.end());
+    data.insert(data.end(), previous_header.begin(), previous_header.end());
+    return bitcoin_hash(data);
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,531 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/filter_index.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/compact_filter.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::blockchain;
+using namespace bc::chain;
+using std::placeholders::_1;
+using std::placeholders::_2;
+using std::placeholders::_3;
+using std::placeholders::_4;
+
+// The number of consecutive blocks whose filters are built concurrently.
+static constexpr size_t filter_batch_size = 64;
+
+// A record is the block hash, the filter header, the size and the filter.
+static constexpr size_t record_prefix = 2 * hash_size + sizeof(uint32_t);
+
+// The delay before building a batch again after it could not be built.
+static constexpr uint32_t retry_seconds = 5;
+
+filter_index::filter_index(threadpool& pool, block_chain& chain,
+    chain_index& index, const boost::filesystem::path& file)
+  : pool_(pool),
+    dispatch_(pool),
+    blockchain_(chain),
+    index_(index),
+    path_(file),
+    target_(0),
+    building_(false),
+    stopped_(true)
+{
+}
+
+bool filter_index::start(uint64_t height)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!load())
+            return false;
+
+        stopped_ = false;
+        target_ = height;
+
+        log::info(LOG_FILTERS)
+            << "Loaded compact filters to #" << entries_.size();
+    }
+
+    blockchain_.subscribe_reorganize(
+        std::bind(&filter_index::handle_reorganize,
+            this, _1, _2, _3, _4));
+
+    build_next();
+    return true;
+}
+
+void filter_index::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+
+    if (retry_timer_)
+        retry_timer_->stop();
+
+    file_.close();
+}
+
+uint64_t filter_index::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+bool filter_index::filter(data_chunk& out_filter, uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return height < entries_.size() && read(out_filter, entries_[height]);
+}
+
+bool filter_index::filter_header(hash_digest& out_header,
+    uint64_t height) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (height >= entries_.size())
+        return false;
+
+    out_header = entries_[height].header;
+    return true;
+}
+
+bool filter_index::match_any(const compact_filter::element_list& scripts,
+    uint64_t height)
+{
+    data_chunk filter;
+    hash_digest block_hash;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (height >= entries_.size() || !read(filter, entries_[height]))
+            return true;
+
+        block_hash = entries_[height].block_hash;
+    }
+
+    return compact_filter::match_any(filter, block_hash, scripts);
+}
+
+void filter_index::handle_reorganize(const code& ec, uint64_t fork_point,
+    const block_chain::list& new_blocks, const block_chain::list&)
+{
+    if (ec == error::service_stopped)
+        return;
+
+    if (!ec)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (stopped_)
+            return;
+
+        // Filters above the fork point are of blocks that were replaced.
+        if (entries_.size() > fork_point + 1)
+            truncate(fork_point + 1);
+
+        target_ = fork_point + new_blocks.size();
+    }
+
+    blockchain_.subscribe_reorganize(
+        std::bind(&filter_index::handle_reorganize,
+            this, _1, _2, _3, _4));
+
+    build_next();
+}
+
+void filter_index::build_next()
+{
+    const auto next = std::make_shared<batch>();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (building_ || stopped_ || retry_timer_ ||
+            entries_.size() > target_)
+            return;
+
+        next->first = entries_.size();
+        const auto count = std::min(target_ - next->first + 1,
+            uint64_t(filter_batch_size));
+
+        for (uint64_t height = next->first; height < next->first + count;
+            ++height)
+        {
+            hash_digest hash;
+
+            if (!index_.hash_at(hash, height))
+                break;
+
+            next->block_hashes.push_back(hash);
+        }
+
+        // The chain index has not yet caught up to the chain.
+        if (next->block_hashes.empty())
+        {
+            schedule_retry();
+            return;
+        }
+
+        next->filters.resize(next->block_hashes.size());
+        next->remaining = next->block_hashes.size();
+        next->failed = false;
+        building_ = true;
+    }
+
+    for (size_t position = 0; position < next->block_hashes.size();
+        ++position)
+        block_fetcher::fetch(blockchain_, next->block_hashes[position],
+            std::bind(&filter_index::handle_fetch_block,
+                this, _1, _2, next, position));
+}
+
+void filter_index::handle_fetch_block(const code& ec, const block& block,
+    batch::ptr batch, size_t position)
+{
+    if (ec)
+    {
+        finish_block(batch, true);
+        return;
+    }
+
+    const auto job = std::make_shared<block_job>();
+    job->owner = batch;
+    job->position = position;
+    job->block = std::make_shared<const chain::block>(block);
+    job->failed = false;
+
+    const auto& transactions = job->block->transactions;
+    std::unordered_map<hash_digest, size_t> positions;
+    size_t inputs = 0;
+
+    for (size_t tx = 0; tx < transactions.size(); ++tx)
+    {
+        positions[transactions[tx].hash()] = tx;
+
+        if (!transactions[tx].is_coinbase())
+            inputs += transactions[tx].inputs.size();
+    }
+
+    job->prevouts.resize(inputs);
+
+    // One more than the inputs, so that the job completes only below.
+    job->remaining = inputs + 1;
+    size_t input = 0;
+
+    for (const auto& tx: transactions)
+    {
+        if (tx.is_coinbase())
+            continue;
+
+        for (const auto& spend: tx.inputs)
+        {
+            const auto& point = spend.previous_output;
+            const auto it = positions.find(point.hash);
+
+            // Outputs spent within the block are not in the chain.
+            if (it == positions.end())
+            {
+                blockchain_.fetch_transaction(point.hash,
+                    std::bind(&filter_index::handle_fetch_previous,
+                        this, _1, _2, point.index, job, input++));
+                continue;
+            }
+
+            const auto& outputs = transactions[it->second].outputs;
+            const auto found = point.index < outputs.size();
+
+            if (found)
+                job->prevouts[input] = outputs[point.index].script;
+
+            ++input;
+            finish_input(job, !found);
+        }
+    }
+
+    finish_input(job, false);
+}
+
+void filter_index::handle_fetch_previous(const code& ec,
+    const transaction& previous, uint32_t index, block_job::ptr job,
+    size_t input)
+{
+    const auto found = !ec && index < previous.outputs.size();
+
+    if (found)
+        job->prevouts[input] = previous.outputs[index].script;
+
+    finish_input(job, !found);
+}
+
+void filter_index::finish_input(block_job::ptr job, bool failed)
+{
+    if (failed)
+        job->failed = true;
+
+    if (--job->remaining != 0)
+        return;
+
+    if (job->failed)
+    {
+        finish_block(job->owner, true);
+        return;
+    }
+
+    // Hashing and coding the filter is moved off the database threads.
+    dispatch_.concurrent(
+        std::bind(&filter_index::build_filter,
+            this, job));
+}
+
+void filter_index::build_filter(block_job::ptr job)
+{
+    const auto& block = *job->block;
+    const auto elements = compact_filter::elements(block, job->prevouts);
+    job->owner->filters[job->position] =
+        compact_filter::build(block.header.hash(), elements);
+
+    finish_block(job->owner, false);
+}
+
+void filter_index::finish_block(batch::ptr batch, bool failed)
+{
+    if (failed)
+        batch->failed = true;
+
+    if (--batch->remaining != 0)
+        return;
+
+    append(batch);
+}
+
+// Filters are appended in height order, and only while their blocks remain
+// in the chain, so that each filter header commits to the previous one.
+void filter_index::append(batch::ptr batch)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_ = false;
+
+        if (stopped_)
+            return;
+
+        if (batch->failed)
+        {
+            log::error(LOG_FILTERS)
+                << "Failure building compact filters from #" << batch->first;
+            schedule_retry();
+            return;
+        }
+
+        // The index was truncated by a reorganization while building.
+        if (batch->first != entries_.size())
+            return;
+
+        for (size_t position = 0; position < batch->filters.size();
+            ++position)
+        {
+            hash_digest hash;
+            const auto& block_hash = batch->block_hashes[position];
+
+            if (!index_.hash_at(hash, batch->first + position) ||
+                hash != block_hash)
+                break;
+
+            if (!write(block_hash, batch->filters[position]))
+            {
+                log::error(LOG_FILTERS)
+                    << "Failure writing compact filter #"
+                    << batch->first + position;
+                schedule_retry();
+                return;
+            }
+        }
+
+        log::debug(LOG_FILTERS)
+            << "Indexed compact filters to #" << entries_.size();
+    }
+
+    build_next();
+}
+
+void filter_index::schedule_retry()
+{
+    if (stopped_ || retry_timer_)
+        return;
+
+    retry_timer_ = std::make_shared<deadline>(pool_,
+        boost::posix_time::seconds(retry_seconds));
+    retry_timer_->start(
+        std::bind(&filter_index::handle_retry,
+            this, _1));
+}
+
+void filter_index::handle_retry(const code& ec)
+{
+    // The timer has been stopped.
+    if (ec)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retry_timer_.reset();
+    }
+
+    build_next();
+}
+
+bool filter_index::open()
+{
+    // Opening for update requires that the file exists.
+    if (!boost::filesystem::exists(path_))
+        std::ofstream(path_.string(), std::ios::binary);
+
+    file_.open(path_.string(),
+        std::ios::in | std::ios::out | std::ios::binary);
+
+    return file_.is_open();
+}
+
+bool filter_index::load()
+{
+    entries_.clear();
+
+    if (!open())
+    {
+        log::error(LOG_FILTERS)
+            << "Failure opening compact filter file " << path_.string();
+        return false;
+    }
+
+    const auto end = boost::filesystem::file_size(path_);
+    uint64_t offset = 0;
+
+    while (offset + record_prefix <= end)
+    {
+        byte_array<record_prefix> prefix;
+        file_.seekg(offset);
+        file_.read(reinterpret_cast<char*>(prefix.data()), prefix.size());
+
+        if (!file_)
+            break;
+
+        entry next;
+        std::copy(prefix.begin(), prefix.begin() + hash_size,
+            next.block_hash.begin());
+        std::copy(prefix.begin() + hash_size, prefix.begin() + 2 * hash_size,
+            next.header.begin());
+        next.size = from_little_endian_unsafe<uint32_t>(
+            prefix.begin() + 2 * hash_size);
+        next.offset = offset + record_prefix;
+
+        // A partial record, or one of a block no longer in the chain (which
+        // was reorganized out while stopped), ends the index.
+        hash_digest hash;
+        if (next.offset + next.size > end ||
+            !index_.hash_at(hash, entries_.size()) || hash != next.block_hash)
+            break;
+
+        entries_.push_back(next);
+        offset = next.offset + next.size;
+    }
+
+    file_.clear();
+    truncate(entries_.size());
+    return file_.is_open();
+}
+
+bool filter_index::read(data_chunk& out_filter, const entry& entry)
+{
+    out_filter.resize(entry.size);
+    file_.seekg(entry.offset);
+    file_.read(reinterpret_cast<char*>(out_filter.data()), entry.size);
+
+    const auto success = !file_.fail();
+    file_.clear();
+    return success;
+}
+
+void filter_index::truncate(uint64_t size)
+{
+    entries_.resize(std::min(size, uint64_t(entries_.size())));
+    const auto end = entries_.empty() ? 0 :
+        entries_.back().offset + entries_.back().size;
+
+    file_.close();
+    boost::filesystem::resize_file(path_, end);
+    open();
+}
+
+bool filter_index::write(const hash_digest& block_hash,
+    const data_chunk& filter)
+{
+    const auto previous = entries_.empty() ? null_hash :
+        entries_.back().header;
+
+    entry next;
+    next.block_hash = block_hash;
+    next.header = compact_filter::header(filter, previous);
+    next.size = static_cast<uint32_t>(filter.size());
+
+    data_chunk record;
+    record.reserve(record_prefix + filter.size());
+    record.insert(record.end(), block_hash.begin(), block_hash.end());
+    record.insert(record.end(), next.header.begin(), next.header.end());
+
+    const auto size = to_little_endian(next.size);
+    record.insert(record.end(), size.begin(), size.end());
+
+    record.insert(record.end(), filter.begin(), filter.end());
+
+    file_.seekp(0, std::ios::end);
+    next.offset = static_cast<uint64_t>(file_.tellp()) + record_prefix;
+    file_.write(reinterpret_cast<const char*>(record.data()), record.size());
+    file_.flush();
+
+    if (file_.fail())
+    {
+        file_.clear();
+        return false;
+    }
+
+    entries_.push_back(next);
+    return true;
+}
+
+} // namespace node
+} // namespace libbitcoin
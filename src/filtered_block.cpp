@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/filtered_block.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/node/bloom_filter.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::chain;
+
+const std::string filtered_block::command = "merkleblock";
+
+static void write_little_endian(data_chunk& data, uint64_t value, size_t size)
+{
+    for (size_t byte = 0; byte < size; ++byte)
+        data.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+}
+
+static size_t variable_size(uint64_t value)
+{
+    return value < 0xfd ? 1 : value <= 0xffff ? 3 :
+        value <= 0xffffffff ? 5 : 9;
+}
+
+static void write_variable(data_chunk& data, uint64_t value)
+{
+    if (value < 0xfd)
+    {
+        data.push_back(static_cast<uint8_t>(value));
+    }
+    else if (value <= 0xffff)
+    {
+        data.push_back(0xfd);
+        write_little_endian(data, value, 2);
+    }
+    else if (value <= 0xffffffff)
+    {
+        data.push_back(0xfe);
+        write_little_endian(data, value, 4);
+    }
+    else
+    {
+        data.push_back(0xff);
+        write_little_endian(data, value, 8);
+    }
+}
+
+filtered_block::filtered_block(const block& block, bloom_filter& filter)
+  : header_(block.header)
+{
+    const auto count = block.transactions.size();
+    tx_hashes_.reserve(count);
+    matched_.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto hash = block.transactions[index].hash();
+        const auto matched = filter.match(block.transactions[index], hash);
+        tx_hashes_.push_back(hash);
+        matched_.push_back(matched);
+
+        if (matched)
+            matches_.push_back(index);
+    }
+
+    if (count == 0)
+        return;
+
+    size_t height = 0;
+    while (width(height) > 1)
+        ++height;
+
+    traverse(height, 0);
+}
+
+const std::vector<size_t>& filtered_block::matches() const
+{
+    return matches_;
+}
+
+const hash_list& filtered_block::hashes() const
+{
+    return hashes_;
+}
+
+// The number of nodes at the height of the tree (leaves at zero).
+size_t filtered_block::width(size_t height) const
+{
+    return (tx_hashes_.size() + (size_t(1) << height) - 1) >> height;
+}
+
+// A node without a right sibling is paired with itself.
+hash_digest filtered_block::subtree_hash(size_t height, size_t position) const
+{
+    if (height == 0)
+        return tx_hashes_[position];
+
+    const auto left = subtree_hash(height - 1, position * 2);
+    const auto right = position * 2 + 1 < width(height - 1) ?
+        subtree_hash(height - 1, position * 2 + 1) : left;
+
+    data_chunk pair(left.begin(), left.end());
+    pair.insert(pair.end(), right.begin(), right.end());
+    return bitcoin_hash(pair);
+}
+
+// A node is descended only if it is the parent of a matched transaction,
+// otherwise its hash stands for the subtree.
+void filtered_block::traverse(size_t height, size_t position)
+{
+    const auto first = position << height;
+    const auto last = std::min((position + 1) << height, tx_hashes_.size());
+    const auto parent = std::find(matched_.begin() + first,
+        matched_.begin() + last, true) != matched_.begin() + last;
+
+    bits_.push_back(parent);
+
+    if (height == 0 || !parent)
+    {
+        hashes_.push_back(subtree_hash(height, position));
+        return;
+    }
+
+    traverse(height - 1, position * 2);
+
+    if (position * 2 + 1 < width(height - 1))
+        traverse(height - 1, position * 2 + 1);
+}
+
+data_chunk filtered_block::to_data() const
+{
+    data_chunk data;
+    data.reserve(satoshi_size());
+
+    const auto header = header_.to_data(false);
+    data.insert(data.end(), header.begin(), header.end());
+    write_little_endian(data, tx_hashes_.size(), 4);
+
+    write_variable(data, hashes_.size());
+    for (const auto& hash: hashes_)
+        data.insert(data.end(), hash.begin(), hash.end());
+
+    // Flag bits are packed least significant bit first.
+    const auto flag_bytes = (bits_.size() + 7) / 8;
+    write_variable(data, flag_bytes);
+    const auto flags = data.size();
+    data.resize(flags + flag_bytes, 0);
+
+    for (size_t bit = 0; bit < bits_.size(); ++bit)
+        if (bits_[bit])
+            data[flags + bit / 8] |= uint8_t(1) << (bit % 8);
+
+    return data;
+}
+
+uint64_t filtered_block::satoshi_size() const
+{
+    const auto flag_bytes = (bits_.size() + 7) / 8;
+    return 80 + 4 + variable_size(hashes_.size()) +
+        hashes_.size() * hash_size + variable_size(flag_bytes) + flag_bytes;
+}
+
+} // namespace node
+} // namespace libbitcoin
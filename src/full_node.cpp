@@ -29,6 +29,8 @@
 #include <boost/lexical_cast.hpp>
 #include <bitcoin/blockchain.hpp>
 #include <bitcoin/node/configuration.hpp>
+#include <bitcoin/node/announcer.hpp>
+#include <bitcoin/node/chain_index.hpp>
 #include <bitcoin/node/full_node.hpp>
 #include <bitcoin/node/indexer.hpp>
 #include <bitcoin/node/poller.hpp>
@@ -53,6 +55,20 @@ static const configuration default_configuration()
     defaults.node.threads = NODE_THREADS;
     defaults.node.transaction_pool_capacity = NODE_TRANSACTION_POOL_CAPACITY;
     defaults.node.peers = NODE_PEERS;
+    defaults.node.headers_first = NODE_HEADERS_FIRST;
+    defaults.node.blocks_per_request = NODE_BLOCKS_PER_REQUEST;
+    defaults.node.block_timeout_seconds = NODE_BLOCK_TIMEOUT_SECONDS;
+    defaults.node.block_minimum_timeout_seconds = NODE_BLOCK_MINIMUM_TIMEOUT_SECONDS;
+    defaults.node.block_stall_limit = NODE_BLOCK_STALL_LIMIT;
+    defaults.node.block_buffer_megabytes = NODE_BLOCK_BUFFER_MEGABYTES;
+    defaults.node.statistics_interval_seconds = NODE_STATISTICS_INTERVAL_SECONDS;
+    defaults.node.relay_trickle_milliseconds = NODE_RELAY_TRICKLE_MILLISECONDS;
+    defaults.node.transaction_timeout_seconds = NODE_TRANSACTION_TIMEOUT_SECONDS;
+    defaults.node.sync_tip_age_minutes = NODE_SYNC_TIP_AGE_MINUTES;
+    defaults.node.block_announce_milliseconds = NODE_BLOCK_ANNOUNCE_MILLISECONDS;
+    defaults.node.request_mempool = NODE_REQUEST_MEMPOOL;
+    defaults.node.block_cache_megabytes = NODE_BLOCK_CACHE_MEGABYTES;
+    defaults.node.compact_filters = NODE_COMPACT_FILTERS;
     defaults.chain.threads = BLOCKCHAIN_THREADS;
     defaults.chain.block_pool_capacity = BLOCKCHAIN_BLOCK_POOL_CAPACITY;
     defaults.chain.history_start_height = BLOCKCHAIN_HISTORY_START_HEIGHT;
@@ -99,10 +115,20 @@ full_node::full_node(const configuration& config)
     network_(config.network),
     node_threads_(config.network.threads, thread_priority::low),
     tx_indexer_(node_threads_),
-    poller_(node_threads_, blockchain_),
-    responder_(blockchain_, tx_pool_),
-    session_(node_threads_, network_, blockchain_, poller_, tx_pool_,
-        responder_, config.last_checkpoint_height())
+    chain_index_(blockchain_),
+    filter_index_(node_threads_, blockchain_, chain_index_,
+        config.chain.database_path / "compact_filters"),
+    sync_state_(config.last_checkpoint_height(),
+        config.node.sync_tip_age_minutes),
+    poller_(node_threads_, blockchain_, chain_index_, sync_state_, config),
+    responder_(blockchain_, chain_index_, sync_state_, tx_pool_,
+        config.node.block_cache_megabytes),
+    announcer_(node_threads_, responder_,
+        config.node.relay_trickle_milliseconds,
+        config.node.block_announce_milliseconds),
+    session_(node_threads_, network_, blockchain_, chain_index_, poller_,
+        sync_state_, tx_pool_, pool_inventory_, responder_, announcer_,
+        config)
 {
 }
 
@@ -127,11 +153,31 @@ node::indexer& full_node::transaction_indexer()
     return tx_indexer_;
 }
 
+node::filter_index& full_node::compact_filters()
+{
+    return filter_index_;
+}
+
 p2p& full_node::network()
 {
     return network_;
 }
 
+peer_score::list full_node::peer_scores() const
+{
+    return poller_.scores();
+}
+
+sync_progress full_node::progress() const
+{
+    return poller_.progress();
+}
+
+const sync_state& full_node::sync() const
+{
+    return sync_state_;
+}
+
 threadpool& full_node::pool()
 {
     return memory_threads_;
@@ -165,44 +211,96 @@ void full_node::handle_blockchain_start(const code& ec, result_handler handler)
 
     tx_pool_.start();
 
-    network_.start(
-        std::bind(&full_node::handle_network_start,
-            this, _1, handler));
+    // Pass the initial blockchain height to the network.
+    blockchain_.fetch_last_height(
+        std::bind(&full_node::handle_fetch_height,
+            this, _1, _2, handler));
 }
 
-void full_node::handle_network_start(const code& ec, result_handler handler)
+void full_node::handle_fetch_height(const code& ec, uint64_t height,
+    result_handler handler)
 {
     if (ec)
     {
-        log::error(LOG_NODE)
-            << "Error starting session: " << ec.message();
+        log::error(LOG_SESSION)
+            << "Error fetching start height: " << ec.message();
         handler(ec);
         return;
     }
 
-    // Subscribe to new connections.
-    network_.subscribe(
-        std::bind(&full_node::handle_new_channel,
-            this, _1, _2));
+    network_.set_height(height);
 
-    // Pass the initial blockchain height to the network.
-    blockchain_.fetch_last_height(
-        std::bind(&full_node::handle_fetch_height,
-            this, _1, _2, handler));
+    // Index the chain in memory before starting the network, so that no
+    // channel connects before the session subscribes to new channels.
+    chain_index_.start(height,
+        std::bind(&full_node::handle_index_start,
+            this, _1, height, handler));
 }
 
-void full_node::handle_fetch_height(const code& ec, uint64_t height,
+void full_node::handle_index_start(const code& ec, uint64_t height,
     result_handler handler)
 {
     if (ec)
     {
-        log::error(LOG_SESSION)
-            << "Error fetching start height: " << ec.message();
+        log::error(LOG_NODE)
+            << "Error indexing chain: " << ec.message();
         handler(ec);
         return;
     }
 
-    network_.set_height(height);
+    log::info(LOG_NODE)
+        << "Indexed chain to #" << height << " "
+        << encode_hash(chain_index_.top_hash());
+
+    // The age of the top block determines whether this is initial download.
+    const auto top = chain_index_.headers(height, null_hash, 1);
+    sync_state_.set_top(height, top.empty() ? 0 : top.front().timestamp);
+
+    // Filters are built in the background from the indexed chain.
+    if (configuration_.node.compact_filters && !filter_index_.start(height))
+    {
+        log::error(LOG_NODE)
+            << "Error starting compact filter index.";
+        handler(error::file_system);
+        return;
+    }
+
+    // Seed the poller with the top of the chain before starting the network.
+    poller_.start(height,
+        std::bind(&full_node::handle_poller_start,
+            this, _1, handler));
+}
+
+void full_node::handle_poller_start(const code& ec, result_handler handler)
+{
+    if (ec)
+    {
+        log::error(LOG_NODE)
+            << "Error starting poller: " << ec.message();
+        handler(ec);
+        return;
+    }
+
+    network_.start(
+        std::bind(&full_node::handle_network_start,
+            this, _1, handler));
+}
+
+void full_node::handle_network_start(const code& ec, result_handler handler)
+{
+    if (ec)
+    {
+        log::error(LOG_NODE)
+            << "Error starting session: " << ec.message();
+        handler(ec);
+        return;
+    }
+
+    // Subscribe to new connections.
+    network_.subscribe(
+        std::bind(&full_node::handle_new_channel,
+            this, _1, _2));
+
     session_.start();
 
     // This is just for logging, the blacklist is used directly from config.
@@ -210,7 +308,7 @@ void full_node::handle_fetch_height(const code& ec, uint64_t height,
         log::info(LOG_NODE)
             << "Blacklisted peer [" << format(authority) << "]";
 
-    // Start configured connections before starting the session.
+    // Start configured connections after subscribing to new channels.
     for (const auto& endpoint: configuration_.node.peers)
         network_.connect(endpoint.host(), endpoint.port(),
             std::bind(&full_node::handle_manual_connect,
@@ -247,6 +345,11 @@ void full_node::stop(result_handler handler)
 {
     code ec(error::success);
 
+    poller_.stop();
+    session_.stop();
+    announcer_.stop();
+    filter_index_.stop();
+
     node_threads_.shutdown();
     database_threads_.shutdown();
     memory_threads_.shutdown();
@@ -311,6 +414,21 @@ void full_node::handle_recieve_tx(const code& ec, const transaction& tx,
         << "Received transaction [" << encoded << "] from ["
         << node->authority() << "]";
 
+    // Other channels that announced the transaction are no longer asked.
+    session_.received_tx(hash);
+
+    // The transaction is not relayed back to the channel that sent it.
+    announcer_.mark(node,
+        { { message::inventory_type_id::transaction, hash } });
+
+    // No memory pool work is done until the chain is synced.
+    if (!sync_state_.synced())
+    {
+        log::debug(LOG_NODE)
+            << "Ignoring transaction [" << encoded << "] before sync.";
+        return;
+    }
+
     // Validate the tx and store it in the memory pool.
     // If validation returns an error then confirmation will never be called.
     tx_pool_.store(tx, 
@@ -337,6 +455,12 @@ void full_node::handle_tx_confirmed(const code& ec, const transaction& tx,
         log::debug(LOG_NODE)
         << "Confirmed transaction [" << encoded << "] into blockchain.";
 
+    pool_inventory_.remove(hash);
+
+    // Transactions are indexed only once the chain is synced.
+    if (!sync_state_.synced())
+        return;
+
     tx_indexer_.deindex(tx,
         std::bind(&full_node::handle_tx_deindexed,
             this, _1, hash));
@@ -386,9 +510,18 @@ void full_node::handle_tx_validated(const code& ec, const transaction& tx,
         << "Accepted transaction [" << encoded
         << "] with unconfirmed input indexes (" << format(unconfirmed) << ")";
 
+    pool_inventory_.store(hash);
+
+    // No memory pool indexing or relay is done until the chain is synced.
+    if (!sync_state_.synced())
+        return;
+
     tx_indexer_.index(tx, 
         std::bind(&full_node::handle_tx_indexed,
             this, _1, hash));
+
+    // Announce the transaction in the next relay batch to each channel.
+    announcer_.relay(tx, hash);
 }
 
 void full_node::handle_tx_indexed(const code& ec, const hash_digest& hash)
@@ -0,0 +1,540 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/header_queue.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/prevalidate.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::chain;
+
+// The difficulty of the easiest block (the proof of work limit).
+static constexpr uint32_t proof_of_work_limit = 0x1d00ffff;
+
+// The intended duration of a retarget period and spacing of its blocks.
+static constexpr uint32_t target_timespan_seconds = 14 * 24 * 60 * 60;
+static constexpr uint32_t target_spacing_seconds = 10 * 60;
+
+// Headers retained below the chain top, so that a competing branch that
+// forks within this depth can be followed.
+static constexpr uint64_t retained_depth = header_queue::retarget_interval;
+
+constexpr uint64_t header_queue::retarget_interval;
+
+// The expected number of hashes required to satisfy the bits.
+static hash_number block_work(uint32_t bits)
+{
+    hash_number target;
+
+    if (!target.set_compact(bits) || target == hash_number(0))
+        return hash_number(0);
+
+    return (~target / (target + hash_number(1))) + hash_number(1);
+}
+
+header_queue::header_queue(const config::checkpoint::list& checkpoints,
+    bool testnet)
+  : checkpoints_(checkpoints),
+    testnet_(testnet),
+    first_height_(0),
+    top_height_(0),
+    next_height_(1)
+{
+}
+
+size_t header_queue::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last() - top_height_;
+}
+
+uint64_t header_queue::first_height() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return first_height_;
+}
+
+uint64_t header_queue::last_height() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last();
+}
+
+hash_digest header_queue::last_hash() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hashes_.empty() ? null_hash : hashes_.back();
+}
+
+uint64_t header_queue::last() const
+{
+    return hashes_.empty() ? first_height_ :
+        first_height_ + hashes_.size() - 1;
+}
+
+bool header_queue::on_queue(const hash_digest& hash, uint64_t height) const
+{
+    return height >= first_height_ && height <= last() && !hashes_.empty() &&
+        hashes_[height - first_height_] == hash;
+}
+
+void header_queue::initialize(const header::list& headers, uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.clear();
+    hashes_.clear();
+    side_.clear();
+    released_.clear();
+    completed_.clear();
+    first_height_ = height;
+
+    const node* parent = nullptr;
+    auto current = height;
+
+    for (const auto& header: headers)
+    {
+        const auto hash = header.hash();
+        const auto it = nodes_.emplace(hash,
+            make_node(header, current++, parent)).first;
+        hashes_.push_back(hash);
+        parent = &it->second;
+    }
+
+    top_height_ = last();
+    next_height_ = top_height_ + 1;
+}
+
+code header_queue::enqueue(const header::list& headers,
+    uint64_t& out_fork_height, hash_list& out_replaced)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_fork_height = last();
+    out_replaced.clear();
+
+    if (hashes_.empty())
+        return error::operation_failed;
+
+    code result = error::success;
+    auto tip = null_hash;
+
+    for (const auto& header: headers)
+    {
+        const auto hash = header.hash();
+
+        if (banned_.find(hash) != banned_.end() ||
+            banned_.find(header.previous_block_hash) != banned_.end())
+        {
+            result = error::operation_failed;
+            break;
+        }
+
+        // Skip known headers (from another peer or an earlier request).
+        if (nodes_.find(hash) != nodes_.end())
+        {
+            tip = hash;
+            continue;
+        }
+
+        const auto parent = nodes_.find(header.previous_block_hash);
+
+        if (parent == nodes_.end())
+        {
+            result = error::bad_stream;
+            break;
+        }
+
+        if (header.bits != work_required(parent->second, header.timestamp))
+        {
+            result = error::incorrect_proof_of_work;
+            break;
+        }
+
+        if (!is_valid_proof_of_work(header))
+        {
+            result = error::proof_of_work;
+            break;
+        }
+
+        const auto height = parent->second.height + 1;
+
+        if (is_checkpoint_conflict(hash, height))
+        {
+            result = error::checkpoints_failed;
+            break;
+        }
+
+        nodes_.emplace(hash, make_node(header, height, &parent->second));
+        side_.insert(hash);
+        tip = hash;
+    }
+
+    // Headers accepted ahead of a failure are retained.
+    if (tip != null_hash && side_.find(tip) != side_.end() &&
+        nodes_[tip].work > nodes_[hashes_.back()].work)
+        reorganize(tip, out_fork_height, out_replaced);
+
+    return result;
+}
+
+bool header_queue::confirm(const header& header, uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto hash = header.hash();
+
+    // A block announced outside of the queue extends it.
+    if (!on_queue(hash, height))
+    {
+        if (hashes_.empty() || height != last() + 1 ||
+            header.previous_block_hash != hashes_.back())
+            return false;
+
+        side_.erase(hash);
+        nodes_[hash] = make_node(header, height, &nodes_[hashes_.back()]);
+        hashes_.push_back(hash);
+    }
+
+    if (height > top_height_)
+    {
+        top_height_ = height;
+        next_height_ = std::max(next_height_, height + 1);
+        released_.erase(released_.begin(), released_.upper_bound(height));
+        completed_.erase(completed_.begin(), completed_.upper_bound(height));
+    }
+
+    prune();
+    return true;
+}
+
+bool header_queue::find(uint64_t& out_height, const hash_digest& hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = nodes_.find(hash);
+
+    // Headers at or below the top are already in the chain.
+    if (it == nodes_.end() || it->second.height <= top_height_ ||
+        !on_queue(hash, it->second.height))
+        return false;
+
+    out_height = it->second.height;
+    return true;
+}
+
+hash_list header_queue::reserve(size_t count, uint64_t max_height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto top = std::min(max_height, last());
+    hash_list hashes;
+
+    // Released hashes are the lowest and so most urgently needed.
+    while (hashes.size() < count && !released_.empty() &&
+        *released_.begin() <= top)
+    {
+        const auto height = *released_.begin();
+        released_.erase(released_.begin());
+
+        if (height > top_height_ && completed_.count(height) == 0)
+            hashes.push_back(hashes_[height - first_height_]);
+    }
+
+    // Blocks received without a reservation are not reserved.
+    for (; hashes.size() < count && next_height_ <= top; ++next_height_)
+        if (completed_.count(next_height_) == 0)
+            hashes.push_back(hashes_[next_height_ - first_height_]);
+
+    return hashes;
+}
+
+void header_queue::release(const hash_list& hashes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto& hash: hashes)
+    {
+        const auto it = nodes_.find(hash);
+
+        if (it == nodes_.end())
+            continue;
+
+        const auto height = it->second.height;
+
+        if (height > top_height_ && height < next_height_ &&
+            completed_.count(height) == 0 && on_queue(hash, height))
+            released_.insert(height);
+    }
+}
+
+void header_queue::complete(const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = nodes_.find(hash);
+
+    if (it == nodes_.end())
+        return;
+
+    const auto height = it->second.height;
+
+    if (height > top_height_ && on_queue(hash, height))
+    {
+        completed_.insert(height);
+        released_.erase(height);
+    }
+}
+
+hash_list header_queue::ban(const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    banned_.insert(hash);
+    hash_list removed;
+    const auto it = nodes_.find(hash);
+
+    if (it == nodes_.end())
+        return removed;
+
+    const auto height = it->second.height;
+
+    if (side_.erase(hash) == 0)
+    {
+        // Blocks in the chain are not removed.
+        if (height <= top_height_)
+            return removed;
+
+        while (last() >= height)
+        {
+            removed.push_back(hashes_.back());
+            banned_.insert(hashes_.back());
+            nodes_.erase(hashes_.back());
+            hashes_.pop_back();
+        }
+
+        std::reverse(removed.begin(), removed.end());
+        next_height_ = std::min(next_height_, height);
+        released_.erase(released_.lower_bound(height), released_.end());
+        completed_.erase(completed_.lower_bound(height), completed_.end());
+    }
+    else
+    {
+        nodes_.erase(hash);
+    }
+
+    // Retained headers above the invalid header are also invalid.
+    for (const auto& descendant: remove_unlinked())
+        banned_.insert(descendant);
+
+    return removed;
+}
+
+bool header_queue::banned(const hash_digest& hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return banned_.find(hash) != banned_.end();
+}
+
+bool header_queue::superseded(const hash_digest& hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return side_.find(hash) != side_.end();
+}
+
+message::block_locator header_queue::locator() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    message::block_locator locator;
+
+    if (hashes_.empty())
+        return locator;
+
+    // Ten dense hashes from the top, then doubling steps.
+    uint64_t step = 1;
+
+    for (auto height = last(); height >= first_height_; height -= step)
+    {
+        locator.push_back(hashes_[height - first_height_]);
+
+        if (locator.size() >= 10)
+            step <<= 1;
+
+        if (height < first_height_ + step)
+            break;
+    }
+
+    return locator;
+}
+
+header_queue::node header_queue::make_node(const header& header,
+    uint64_t height, const node* parent) const
+{
+    const auto retarget = parent == nullptr ||
+        height % retarget_interval == 0;
+
+    node result;
+    result.parent = header.previous_block_hash;
+    result.height = height;
+    result.bits = header.bits;
+    result.timestamp = header.timestamp;
+    result.period_start = retarget ? header.timestamp : parent->period_start;
+    result.normal_bits = retarget || header.bits != proof_of_work_limit ?
+        header.bits : parent->normal_bits;
+    result.work = block_work(header.bits);
+
+    if (parent != nullptr)
+        result.work += parent->work;
+
+    return result;
+}
+
+// The difficulty required of the block following the parent.
+uint32_t header_queue::work_required(const node& parent,
+    uint32_t timestamp) const
+{
+    if ((parent.height + 1) % retarget_interval != 0)
+    {
+        if (!testnet_)
+            return parent.bits;
+
+        // Testnet allows a minimum difficulty block after twice the target
+        // spacing, otherwise the difficulty is that of the last normal block.
+        const auto limit = static_cast<uint64_t>(parent.timestamp) +
+            2 * target_spacing_seconds;
+
+        return timestamp > limit ? proof_of_work_limit : parent.normal_bits;
+    }
+
+    // The actual timespan of the period is bounded to a factor of four.
+    const int64_t actual = static_cast<int64_t>(parent.timestamp) -
+        parent.period_start;
+    const int64_t minimum = target_timespan_seconds / 4;
+    const int64_t maximum = target_timespan_seconds * 4;
+    const auto timespan = static_cast<uint32_t>(
+        std::min(std::max(actual, minimum), maximum));
+
+    hash_number target;
+    target.set_compact(parent.bits);
+    target *= timespan;
+    target /= target_timespan_seconds;
+
+    hash_number limit;
+    limit.set_compact(proof_of_work_limit);
+    return target > limit ? proof_of_work_limit : target.compact();
+}
+
+bool header_queue::is_checkpoint_conflict(const hash_digest& hash,
+    uint64_t height) const
+{
+    for (const auto& checkpoint: checkpoints_)
+        if (checkpoint.height() == height)
+            return checkpoint.hash() != hash;
+
+    return false;
+}
+
+// Move the queue to the branch ending at the retained header. Queued headers
+// above the fork are retained so that the queue may move back to them.
+void header_queue::reorganize(const hash_digest& tip,
+    uint64_t& out_fork_height, hash_list& out_replaced)
+{
+    hash_list branch;
+    auto hash = tip;
+
+    while (side_.find(hash) != side_.end())
+    {
+        branch.push_back(hash);
+        hash = nodes_[hash].parent;
+    }
+
+    const auto fork = nodes_[hash].height;
+
+    while (last() > fork)
+    {
+        const auto replaced = hashes_.back();
+
+        if (last() > top_height_)
+            out_replaced.push_back(replaced);
+
+        side_.insert(replaced);
+        hashes_.pop_back();
+    }
+
+    for (auto it = branch.rbegin(); it != branch.rend(); ++it)
+    {
+        side_.erase(*it);
+        hashes_.push_back(*it);
+    }
+
+    std::reverse(out_replaced.begin(), out_replaced.end());
+    out_fork_height = fork;
+    top_height_ = std::min(top_height_, fork);
+    next_height_ = std::min(next_height_, fork + 1);
+    released_.erase(released_.upper_bound(fork), released_.end());
+    completed_.erase(completed_.upper_bound(fork), completed_.end());
+}
+
+// Remove retained headers that no longer link to the queue.
+hash_list header_queue::remove_unlinked()
+{
+    hash_list removed;
+    auto found = true;
+
+    while (found)
+    {
+        found = false;
+
+        for (auto it = side_.begin(); it != side_.end();)
+        {
+            const auto parent = nodes_[*it].parent;
+
+            if (nodes_.find(parent) != nodes_.end())
+            {
+                ++it;
+                continue;
+            }
+
+            removed.push_back(*it);
+            nodes_.erase(*it);
+            it = side_.erase(it);
+            found = true;
+        }
+    }
+
+    return removed;
+}
+
+// Discard headers more than the retained depth below the chain top.
+void header_queue::prune()
+{
+    if (top_height_ < first_height_ + retained_depth)
+        return;
+
+    for (; first_height_ < top_height_ - retained_depth; ++first_height_)
+    {
+        nodes_.erase(hashes_.front());
+        hashes_.pop_front();
+    }
+
+    remove_unlinked();
+}
+
+} // namespace node
+} // namespace libbitcoin
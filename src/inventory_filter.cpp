@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/inventory_filter.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+// Twenty bits and ten functions per hash give a false positive rate of about
+// one in ten thousand at capacity.
+static constexpr size_t bits_per_hash = 20;
+static constexpr size_t hash_functions = 10;
+
+inventory_filter::inventory_filter(size_t capacity)
+  : capacity_(std::max(capacity, size_t(1))),
+    size_(capacity_ * bits_per_hash),
+    tweak_(pseudo_random()),
+    inserted_(0),
+    current_(size_, false),
+    previous_(size_, false)
+{
+}
+
+// The hash is uniformly distributed, so its words seed double hashing.
+size_t inventory_filter::position(const hash_digest& hash,
+    size_t function) const
+{
+    const auto first = from_little_endian_unsafe<uint64_t>(hash.begin());
+    const auto second = from_little_endian_unsafe<uint64_t>(hash.begin() + 8);
+    return ((first ^ tweak_) + function * (second | 1)) % size_;
+}
+
+void inventory_filter::insert(const hash_digest& hash)
+{
+    if (inserted_ == capacity_)
+    {
+        previous_.swap(current_);
+        std::fill(current_.begin(), current_.end(), false);
+        inserted_ = 0;
+    }
+
+    for (size_t function = 0; function < hash_functions; ++function)
+        current_[position(hash, function)] = true;
+
+    ++inserted_;
+}
+
+bool inventory_filter::contains(const hash_digest& hash) const
+{
+    return contains(current_, hash) || contains(previous_, hash);
+}
+
+bool inventory_filter::contains(const bit_set& bits,
+    const hash_digest& hash) const
+{
+    for (size_t function = 0; function < hash_functions; ++function)
+        if (!bits[position(hash, function)])
+            return false;
+
+    return true;
+}
+
+void inventory_filter::clear()
+{
+    std::fill(current_.begin(), current_.end(), false);
+    std::fill(previous_.begin(), previous_.end(), false);
+    inserted_ = 0;
+}
+
+} // namespace node
+} // namespace libbitcoin
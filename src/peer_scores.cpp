@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/peer_scores.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::network;
+
+// The weight of a new sample in the smoothed latency and rate.
+static constexpr double smoothing = 0.2;
+
+// The bounds of a channel's share relative to that of an average channel.
+static constexpr double minimum_share = 0.25;
+static constexpr double maximum_share = 2.0;
+
+peer_scores::peer_scores(uint32_t stall_seconds)
+  : stall_period_(std::chrono::seconds(stall_seconds))
+{
+}
+
+void peer_scores::add(channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    measures_.emplace(node, measure{});
+}
+
+void peer_scores::requested(channel::ptr node, size_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = measures_.find(node);
+
+    if (it == measures_.end())
+        return;
+
+    auto& measure = it->second;
+
+    // Time spent idle is not charged to the channel.
+    if (measure.outstanding == 0)
+        measure.last_activity = clock::now();
+
+    measure.outstanding += count;
+}
+
+void peer_scores::received(channel::ptr node, uint64_t bytes)
+{
+    typedef std::chrono::duration<double> seconds;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = measures_.find(node);
+
+    // A block may arrive after its channel has been removed.
+    if (it == measures_.end())
+        return;
+
+    auto& measure = it->second;
+    const auto now = clock::now();
+
+    // Guard against a zero interval from a coarse clock.
+    const auto interval = std::max(seconds(now - measure.last_activity).count(),
+        0.001);
+    const auto rate = bytes / interval;
+
+    if (measure.blocks == 0)
+    {
+        measure.latency = interval;
+        measure.rate = rate;
+    }
+    else
+    {
+        measure.latency += smoothing * (interval - measure.latency);
+        measure.rate += smoothing * (rate - measure.rate);
+    }
+
+    ++measure.blocks;
+    measure.bytes += bytes;
+    measure.stalls = 0;
+    measure.last_activity = now;
+
+    if (measure.outstanding > 0)
+        --measure.outstanding;
+}
+
+uint32_t peer_scores::stalled(channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = measures_.find(node);
+
+    if (it == measures_.end())
+        return 0;
+
+    auto& measure = it->second;
+    const auto now = clock::now();
+
+    // The requests of one stall expire together, so count them once.
+    if (measure.stalls == 0 || now - measure.last_stall >= stall_period_)
+    {
+        ++measure.stalls;
+        measure.rate /= 2;
+        measure.last_stall = now;
+        measure.outstanding = 0;
+    }
+
+    return measure.stalls;
+}
+
+void peer_scores::remove(channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    measures_.erase(node);
+}
+
+size_t peer_scores::share(channel::ptr node, size_t count) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = measures_.find(node);
+    const auto average = average_rate();
+
+    if (it == measures_.end() || it->second.blocks == 0 || average <= 0)
+        return count;
+
+    const auto ratio = std::min(std::max(it->second.rate / average,
+        minimum_share), maximum_share);
+
+    return std::max(static_cast<size_t>(count * ratio), size_t(1));
+}
+
+std::chrono::milliseconds peer_scores::latency(channel::ptr node) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = measures_.find(node);
+
+    if (it == measures_.end() || it->second.blocks == 0)
+        return std::chrono::milliseconds::zero();
+
+    return std::chrono::milliseconds(
+        static_cast<int64_t>(it->second.latency * 1000));
+}
+
+uint64_t peer_scores::rate(channel::ptr node) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = measures_.find(node);
+    return it == measures_.end() ? 0 :
+        static_cast<uint64_t>(it->second.rate);
+}
+
+peer_score::list peer_scores::scores() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_score::list scores;
+    scores.reserve(measures_.size());
+
+    for (const auto& entry: measures_)
+    {
+        const auto& measure = entry.second;
+        scores.push_back(
+        {
+            entry.first->authority(),
+            measure.blocks,
+            measure.bytes,
+            static_cast<uint32_t>(measure.latency * 1000),
+            static_cast<uint64_t>(measure.rate),
+            measure.stalls
+        });
+    }
+
+    return scores;
+}
+
+double peer_scores::average_rate() const
+{
+    size_t measured = 0;
+    double total = 0;
+
+    for (const auto& entry: measures_)
+    {
+        if (entry.second.blocks == 0)
+            continue;
+
+        total += entry.second.rate;
+        ++measured;
+    }
+
+    return measured == 0 ? 0 : total / measured;
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -19,7 +19,21 @@
  */
 #include <bitcoin/node/poller.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/configuration.hpp>
+#include <bitcoin/node/header_queue.hpp>
+#include <bitcoin/node/peer_scores.hpp>
+#include <bitcoin/node/prevalidate.hpp>
+#include <bitcoin/node/reorder_buffer.hpp>
+#include <bitcoin/node/request_tracker.hpp>
+#include <bitcoin/node/sync_statistics.hpp>
 
 namespace libbitcoin {
 namespace node {
@@ -29,10 +43,273 @@ using namespace bc::message;
 using namespace bc::network;
 using std::placeholders::_1;
 using std::placeholders::_2;
+using std::placeholders::_3;
+using std::placeholders::_4;
 
-poller::poller(threadpool& pool, block_chain& chain)
-  : dispatch_(pool),  blockchain_(chain)
+// The protocol limit on the number of headers in a headers message.
+static constexpr size_t max_headers = 2000;
+
+static constexpr size_t megabyte = 1024 * 1024;
+
+// The multiple of a channel's block latency allowed before a request expires.
+static constexpr int64_t latency_factor = 4;
+
+// The delay before seeding the header queue again after it could not be.
+static constexpr uint32_t seed_retry_seconds = 1;
+
+poller::poller(threadpool& pool, block_chain& chain, chain_index& index,
+    sync_state& sync, const configuration& configuration)
+  : pool_(pool),
+    dispatch_(pool),
+    blockchain_(chain),
+    index_(index),
+    sync_(sync),
+    headers_first_(configuration.node.headers_first),
+    blocks_per_request_(configuration.node.blocks_per_request),
+    headers_(configuration.chain.checkpoints,
+        configuration.chain.use_testnet_rules),
+    tracker_(pool, configuration.node.block_timeout_seconds),
+    buffer_(configuration.node.block_buffer_megabytes * megabyte),
+    scores_(configuration.node.block_timeout_seconds),
+    stall_limit_(configuration.node.block_stall_limit),
+    minimum_timeout_(std::chrono::seconds(
+        configuration.node.block_minimum_timeout_seconds)),
+    maximum_timeout_(std::chrono::seconds(
+        configuration.node.block_timeout_seconds)),
+    statistics_interval_(configuration.node.statistics_interval_seconds),
+    seeded_(false),
+    seeding_(false),
+    storing_(false)
+{
+}
+
+void poller::start(uint64_t height, result_handler handler)
+{
+    tracker_.start(
+        std::bind(&poller::handle_expired,
+            this, _1, _2));
+
+    if (statistics_interval_ > 0)
+    {
+        const auto interval = boost::posix_time::seconds(statistics_interval_);
+        statistics_timer_ = std::make_shared<deadline>(pool_, interval);
+        start_statistics_timer();
+    }
+
+    if (!headers_first_)
+    {
+        handler(error::success);
+        return;
+    }
+
+    seed_timer_ = std::make_shared<deadline>(pool_,
+        boost::posix_time::seconds(seed_retry_seconds));
+
+    // This precedes any channel so it does not require ordered dispatch.
+    seed(height, {});
+
+    blockchain_.subscribe_reorganize(
+        std::bind(&poller::handle_reorganize,
+            this, _1, _2, _3, _4));
+
+    handler(error::success);
+}
+
+// Seed the queue with the chain from the retarget height below its top, as
+// the difficulty of the next header depends upon the retarget period. The
+// headers are taken from the index up to the fork point and then from the
+// new blocks, which the index may not yet have.
+bool poller::seed(uint64_t fork_point, const block_chain::list& new_blocks)
+{
+    const auto top = fork_point + new_blocks.size();
+    const auto start = top - top % header_queue::retarget_interval;
+    chain::header::list headers;
+
+    if (start <= fork_point)
+        headers = index_.headers(start, null_hash, fork_point - start + 1);
+
+    auto height = fork_point;
+
+    for (const auto block: new_blocks)
+        if (++height >= start)
+            headers.push_back(block->header);
+
+    if (headers.size() != top - start + 1)
+    {
+        log::warning(LOG_POLLER)
+            << "Chain index is behind the chain at #" << fork_point
+            << ", header queue not seeded.";
+        seeded_ = false;
+        start_seed_timer();
+        return false;
+    }
+
+    headers_.initialize(headers, start);
+    buffer_.initialize(top + 1);
+    seeded_ = true;
+
+    log::debug(LOG_POLLER)
+        << "Header queue seeded at #" << top << " "
+        << encode_hash(headers.back().hash());
+
+    return true;
+}
+
+void poller::handle_reorganize(const code& ec, uint64_t fork_point,
+    const block_chain::list& new_blocks, const block_chain::list&)
+{
+    if (ec == error::service_stopped)
+        return;
+
+    if (ec)
+        log::error(LOG_POLLER)
+            << "Failure in reorganize: " << ec.message();
+    else
+        dispatch_.ordered(
+            std::bind(&poller::confirm_blocks,
+                this, fork_point, new_blocks));
+
+    blockchain_.subscribe_reorganize(
+        std::bind(&poller::handle_reorganize,
+            this, _1, _2, _3, _4));
+}
+
+// Advance the queue with the blocks accepted into the chain.
+void poller::confirm_blocks(uint64_t fork_point,
+    const block_chain::list& new_blocks)
+{
+    // The queue is seeded from the chain once the index has caught up.
+    if (!seeded_)
+    {
+        resync(fork_point, new_blocks);
+        return;
+    }
+
+    auto height = fork_point;
+
+    for (const auto block: new_blocks)
+    {
+        if (!headers_.confirm(block->header, ++height))
+        {
+            resync(fork_point, new_blocks);
+            return;
+        }
+    }
+}
+
+// The chain has moved to a branch that the queue does not hold, so the queue
+// is seeded again from the chain and every channel is asked for headers.
+void poller::resync(uint64_t fork_point, const block_chain::list& new_blocks)
+{
+    log::info(LOG_POLLER)
+        << "Chain reorganized off of the header queue at #" << fork_point
+        << ", resynchronizing headers.";
+
+    hash_list reserved;
+
+    for (const auto& reservation: reservations_)
+        reserved.insert(reserved.end(), reservation.second.begin(),
+            reservation.second.end());
+
+    cancel(reserved);
+    relocated_.clear();
+
+    if (!seed(fork_point, new_blocks))
+        return;
+
+    for (const auto& reservation: reservations_)
+        request_headers(reservation.first);
+}
+
+// The seed is retried from the index if it fails, as the index is updated
+// from the chain independently of the poller.
+void poller::start_seed_timer()
+{
+    if (seeding_)
+        return;
+
+    seeding_ = true;
+    seed_timer_->start(
+        std::bind(&poller::handle_seed_timer,
+            this, _1));
+}
+
+void poller::handle_seed_timer(const code& ec)
 {
+    // The timer has been stopped.
+    if (ec)
+        return;
+
+    dispatch_.ordered(
+        std::bind(&poller::reseed,
+            this));
+}
+
+void poller::reseed()
+{
+    seeding_ = false;
+    const auto size = index_.size();
+
+    // A reorganization may have seeded the queue since the timer started.
+    if (seeded_ || size == 0)
+    {
+        if (!seeded_)
+            start_seed_timer();
+
+        return;
+    }
+
+    if (!seed(size - 1, {}))
+        return;
+
+    for (const auto& reservation: reservations_)
+        request_headers(reservation.first);
+}
+
+void poller::stop()
+{
+    tracker_.stop();
+
+    if (statistics_timer_)
+        statistics_timer_->stop();
+
+    if (seed_timer_)
+        seed_timer_->stop();
+}
+
+sync_progress poller::progress() const
+{
+    return statistics_.progress();
+}
+
+void poller::start_statistics_timer()
+{
+    statistics_timer_->start(
+        std::bind(&poller::handle_statistics_timer,
+            this, _1));
+}
+
+void poller::handle_statistics_timer(const code& ec)
+{
+    // The timer has been stopped.
+    if (ec)
+        return;
+
+    const auto progress = statistics_.sample(tracker_.size(),
+        headers_.last_height());
+
+    log::info(LOG_POLLER)
+        << "Sync #" << progress.height << " of #" << progress.target_height
+        << " eta " << progress.eta_seconds << "s, "
+        << static_cast<uint64_t>(progress.blocks_per_second) << " blocks/s "
+        << static_cast<uint64_t>(progress.transactions_per_second)
+        << " txs/s " << static_cast<uint64_t>(progress.bytes_per_second)
+        << " bytes/s, store " << progress.store_p50_milliseconds << "/"
+        << progress.store_p90_milliseconds << "/"
+        << progress.store_p99_milliseconds << " ms (p50/p90/p99), orphaned "
+        << progress.orphaned_total << ", in flight " << progress.in_flight;
+
+    start_statistics_timer();
 }
 
 // Start monitoring this channel.
@@ -46,7 +323,26 @@ void poller::monitor(channel::ptr node)
         std::bind(&poller::receive_block,
             this, _1, _2, node));
 
-    request_blocks(null_hash, node);
+    // The channel must be registered before its stop can be handled.
+    dispatch_.ordered(
+        std::bind(&poller::start_download,
+            this, node));
+
+    node->subscribe_stop(
+        std::bind(&poller::handle_channel_stop,
+            this, _1, node));
+
+    if (!headers_first_)
+    {
+        request_blocks(null_hash, node);
+        return;
+    }
+
+    node->subscribe<headers>(
+        std::bind(&poller::receive_headers,
+            this, _1, _2, node));
+
+    request_headers(node);
 }
 
 void poller::receive_block(const code& ec, const block& block,
@@ -68,17 +364,132 @@ void poller::receive_block(const code& ec, const block& block,
         std::bind(&poller::receive_block,
             this, _1, _2, node));
 
+    // Context-free checks run concurrently, ahead of the ordered store.
+    dispatch_.concurrent(
+        std::bind(&poller::prevalidate_block,
+            this, block, node));
+}
+
+void poller::prevalidate_block(const block& block, channel::ptr node)
+{
+    const auto ec = prevalidate(block);
+
+    if (ec)
+    {
+        const auto hash = block.header.hash();
+        log::warning(LOG_POLLER)
+            << "Invalid block [" << encode_hash(hash) << "] from ["
+            << node->authority() << "] " << ec.message();
+
+        // The stop reassigns all of the channel's outstanding requests.
+        node->stop(ec);
+        return;
+    }
+
+    dispatch_.ordered(
+        std::bind(&poller::handle_block,
+            this, block, node));
+}
+
+void poller::handle_block(const block& block, channel::ptr node)
+{
+    uint64_t height;
+    const auto hash = block.header.hash();
+
+    if (tracker_.complete(hash))
+    {
+        const auto size = block.serialized_size();
+        scores_.received(node, size);
+        statistics_.downloaded(size);
+    }
+
+    // Blocks of an invalidated or replaced branch may still arrive from
+    // requests made before the branch was dropped.
+    if (headers_first_ && (headers_.banned(hash) ||
+        headers_.superseded(hash)))
+    {
+        log::debug(LOG_POLLER)
+            << "Dropped block [" << encode_hash(hash) << "]";
+        return;
+    }
+
+    // Blocks not in the header queue (such as new announcements) are stored
+    // directly and may be accepted into the orphan pool.
+    if (!headers_first_ || !headers_.find(height, hash))
+    {
+        if (index_.exists(hash))
+        {
+            log::debug(LOG_POLLER)
+                << "Redundant block [" << encode_hash(hash) << "]";
+            return;
+        }
+
+        store_block(block, node, false);
+        return;
+    }
+
+    unreserve(hash);
+    headers_.complete(hash);
+
+    if (!buffer_.push(height, block, node))
+        log::debug(LOG_POLLER)
+            << "Redundant block [" << encode_hash(hash) << "]";
+
+    release_block();
+}
+
+// Release buffered blocks to the store in height order, one at a time, so
+// that blocks waiting on the store remain counted against the buffer limit.
+void poller::release_block()
+{
+    if (storing_)
+        return;
+
+    const auto paused = buffer_.full();
+    channel::ptr source;
+    chain::block next;
+
+    if (buffer_.pop(next, source))
+    {
+        storing_ = true;
+        store_block(next, source, true);
+    }
+
+    // Resume requests that were paused by a full buffer.
+    if (paused && !buffer_.full())
+    {
+        log::debug(LOG_POLLER)
+            << "Block buffer drained to (" << buffer_.size()
+            << ") blocks, resuming requests.";
+        request_idle();
+    }
+}
+
+void poller::store_block(const block& block, channel::ptr node,
+    bool buffered)
+{
     blockchain_.store(block,
         dispatch_.ordered_delegate(&poller::handle_store_block,
-            this, _1, _2, block.header.hash(), node));
+            this, _1, _2, block.header.hash(), block.transactions.size(),
+            clock::now(), node, buffered));
 }
 
 void poller::handle_store_block(const code& ec, const block_info& info,
-    const hash_digest& hash, channel::ptr node)
+    const hash_digest& hash, size_t transactions,
+    const clock::time_point& start, channel::ptr node, bool buffered)
 {
     if (ec == error::service_stopped)
         return;
 
+    // Release the next buffered block once this one has been handled.
+    if (buffered)
+    {
+        storing_ = false;
+        dispatch_.ordered(
+            std::bind(&poller::release_block,
+                this));
+    }
+
     const auto encoded = encode_hash(hash);
 
     if (ec == error::duplicate)
@@ -95,6 +506,13 @@ void poller::handle_store_block(const code& ec, const block_info& info,
             << "Error storing block [" << encoded << "] from ["
             << node->authority() << "] " << ec.message();
         node->stop(ec);
+
+        // The header of an invalid queued block is invalid, as is the branch
+        // above it.
+        uint64_t height;
+        if (headers_first_ && headers_.find(height, hash))
+            invalidate(hash, height);
+
         return;
     }
     
@@ -102,13 +520,25 @@ void poller::handle_store_block(const code& ec, const block_info& info,
     {
         // The block has been accepted as an orphan (ec not set).
         case block_status::orphan:
+        {
             log::debug(LOG_POLLER)
                 << "Potential block [" << encoded << "]";
 
+            statistics_.orphaned();
+
             // This is how we get other nodes to send us the blocks we are
-            // missing from the top of our chain to the orphan.
-            request_blocks(hash, node);
+            // missing from the top of our chain to the orphan. Queued blocks
+            // of a branch with more work have their parents queued. In
+            // headers-first mode the missing blocks are found through the
+            // headers of the peer's branch, which then queue their download.
+            uint64_t height;
+            if (!headers_first_)
+                request_blocks(hash, node);
+            else if (!headers_.find(height, hash))
+                request_headers(node);
+
             break;
+        }
 
         // The block has been rejected from the store (redundant?).
         // This case may be redundant with error::duplicate.
@@ -122,35 +552,486 @@ void poller::handle_store_block(const code& ec, const block_info& info,
         case block_status::confirmed:
             log::info(LOG_POLLER)
                 << "Block #" << info.height << " " << encoded;
+
+            statistics_.stored(info.height, transactions,
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    clock::now() - start));
             break;
     }
 }
 
-void poller::request_blocks(const hash_digest& stop, channel::ptr node)
+// The locator is that of the queue, completed by the chain below the queue,
+// so that a peer on another branch responds from the fork point.
+void poller::request_headers(channel::ptr node, const hash_digest& start)
 {
-    block_locator_fetcher::fetch(blockchain_,
-        dispatch_.ordered_delegate(&poller::get_blocks,
-            this, _1, _2, stop, node));
+    auto locator = headers_.locator();
+    const auto first = headers_.first_height();
+
+    for (const auto& hash: index_.locator())
+    {
+        uint64_t height;
+        if (index_.find(height, hash) && height < first)
+            locator.push_back(hash);
+    }
+
+    // Continue from the last header sent by the peer, which may not be queued.
+    if (start != null_hash && (locator.empty() || locator.front() != start))
+        locator.insert(locator.begin(), start);
+
+    if (locator.empty())
+        return;
+
+    log::debug(LOG_POLLER)
+        << "Send get headers to [" << node->authority() << "] start ["
+        << encode_hash(locator.front()) << "](" << locator.size() << ")";
+
+    const get_headers packet{ locator, null_hash };
+
+    node->send(packet,
+        std::bind(&poller::handle_send_headers,
+            this, _1, node));
 }
 
-// Not having orphans will cause a stall unless mitigated.
-void poller::get_blocks(const code& ec, const block_locator& locator,
-    const hash_digest& stop, channel::ptr node)
+void poller::handle_send_headers(const code& ec, channel::ptr node)
 {
-    if (ec == error::service_stopped)
+    if (ec)
+    {
+        log::debug(LOG_POLLER)
+            << "Failure sending get headers to [" << node->authority()
+            << "] " << ec.message();
+        node->stop(ec);
+    }
+}
+
+void poller::receive_headers(const code& ec, const headers& packet,
+    channel::ptr node)
+{
+    if (ec == error::channel_stopped)
         return;
 
-    const auto start = locator.front();
-    const auto encoded = encode_hash(start);
+    if (ec)
+    {
+        log::warning(LOG_POLLER)
+            << "Received bad headers from [" << node->authority() << "] "
+            << ec.message();
+        node->stop(ec);
+        return;
+    }
+
+    node->subscribe<headers>(
+        std::bind(&poller::receive_headers,
+            this, _1, _2, node));
+
+    // Branch changes affect reservations, so headers are ordered with them.
+    dispatch_.ordered(
+        std::bind(&poller::handle_headers,
+            this, packet, node));
+}
+
+void poller::handle_headers(const headers& packet, channel::ptr node)
+{
+    // Headers are requested again from every channel once the queue is
+    // seeded, so this is not a fault of the peer.
+    if (!seeded_)
+    {
+        log::debug(LOG_POLLER)
+            << "Header queue not seeded, deferring headers from ["
+            << node->authority() << "]";
+        return;
+    }
+
+    uint64_t fork_height;
+    hash_list replaced;
+    const auto result = headers_.enqueue(packet.elements, fork_height,
+        replaced);
+
+    // Requests and buffered blocks of a replaced branch are discarded.
+    if (!replaced.empty())
+        log::info(LOG_POLLER)
+            << "Header queue reorganized at #" << fork_height << ", ("
+            << replaced.size() << ") headers replaced.";
+
+    cancel(replaced);
+    buffer_.truncate(fork_height);
+
+    // Unlinked headers are from a peer on another branch, or that is behind.
+    // The peer is asked once to locate its fork from the queue and chain.
+    if (result == error::bad_stream)
+    {
+        log::debug(LOG_POLLER)
+            << "Unlinked headers from [" << node->authority() << "] ("
+            << packet.elements.size() << ")";
+
+        if (relocated_.insert(node).second)
+            request_headers(node);
+
+        return;
+    }
+
+    if (result)
+    {
+        log::warning(LOG_POLLER)
+            << "Invalid headers from [" << node->authority() << "] "
+            << result.message();
+        node->stop(result);
+        return;
+    }
+
+    relocated_.erase(node);
+
+    log::debug(LOG_POLLER)
+        << "Headers from [" << node->authority() << "] ("
+        << packet.elements.size() << ") top #" << headers_.last_height();
+
+    // Validated headers are the most reliable measure of the network chain.
+    sync_.set_target(headers_.last_height());
+
+    // A full headers message implies that the peer has more to send.
+    if (packet.elements.size() == max_headers)
+        request_headers(node, packet.elements.back().hash());
+
+    request_idle();
+}
+
+void poller::start_download(channel::ptr node)
+{
+    reservations_.emplace(node, hash_list{});
+    scores_.add(node);
+
+    if (headers_first_)
+        request_reserved(node);
+}
+
+// Reserve the next range of block hashes for download by this channel.
+void poller::request_reserved(channel::ptr node)
+{
+    const auto reserved = reservations_.find(node);
+
+    // The channel is stopped or is still working on its reservation.
+    if (reserved == reservations_.end() || !reserved->second.empty())
+        return;
+
+    // When the buffer is full only blocks below its top are requested, as
+    // these are required to drain it.
+    const auto full = buffer_.full();
+    const auto limit = full ? buffer_.top_height() : max_uint64;
+    // Faster channels are given a larger share of the blocks.
+    const auto count = scores_.share(node, blocks_per_request_);
+    const auto hashes = headers_.reserve(count, limit);
+
+    if (full && hashes.empty())
+        log::debug(LOG_POLLER)
+            << "Block buffer full (" << buffer_.bytes() << " bytes), pausing ["
+            << node->authority() << "]";
+
+    // Blocks already in flight from another channel are not reserved here.
+    // They are released to the queue if that request expires.
+    get_data packet;
+    const auto latency = scores_.latency(node);
+
+    for (const auto& hash: hashes)
+    {
+        const auto timeout = request_timeout(latency,
+            packet.inventories.size());
+
+        if (tracker_.request(hash, node, timeout))
+        {
+            reserved->second.push_back(hash);
+            packet.inventories.push_back({ inventory_type_id::block, hash });
+        }
+    }
+
+    if (packet.inventories.empty())
+        return;
+
+    log::debug(LOG_POLLER)
+        << "Requesting blocks (" << packet.inventories.size() << ") from ["
+        << node->authority() << "] start ["
+        << encode_hash(packet.inventories.front().hash) << "]";
+
+    scores_.requested(node, packet.inventories.size());
 
+    node->send(packet,
+        std::bind(&poller::handle_send_request,
+            this, _1, packet.inventories.size(), node));
+}
+
+// A block is expected after the blocks ahead of it in the request, each at the
+// channel's measured latency. It is allowed a multiple of that latency beyond
+// its expected arrival, within the configured bounds. Unmeasured channels are
+// allowed the maximum.
+request_tracker::duration poller::request_timeout(
+    const request_tracker::duration& latency, size_t position) const
+{
+    if (latency == request_tracker::duration::zero())
+        return maximum_timeout_;
+
+    const auto expected = latency * static_cast<int64_t>(position);
+    const auto slack = std::min(std::max(latency * latency_factor,
+        minimum_timeout_), maximum_timeout_);
+
+    return expected + slack;
+}
+
+void poller::request_idle()
+{
+    for (const auto& reservation: reservations_)
+        if (reservation.second.empty())
+            request_reserved(reservation.first);
+}
+
+void poller::handle_send_request(const code& ec, size_t count,
+    channel::ptr node)
+{
     if (ec)
     {
         log::debug(LOG_POLLER)
-            << "Failure to fetch block locator for [" << node->authority()
-            << "] with start [" << encoded << "]";
+            << "Failure requesting blocks (" << count << ") from ["
+            << node->authority() << "] " << ec.message();
+        node->stop(ec);
+    }
+}
+
+void poller::handle_channel_stop(const code&, channel::ptr node)
+{
+    dispatch_.ordered(
+        std::bind(&poller::release_reserved,
+            this, node));
+}
+
+// Return the outstanding reservation of a stopped channel to the queue.
+void poller::release_reserved(channel::ptr node)
+{
+    const auto reserved = reservations_.find(node);
+
+    if (reserved == reservations_.end())
         return;
+
+    headers_.release(reserved->second);
+    reservations_.erase(reserved);
+    relocated_.erase(node);
+
+    log::debug(LOG_POLLER)
+        << "Block rate of [" << node->authority() << "] was ("
+        << scores_.rate(node) << ") bytes per second.";
+
+    scores_.remove(node);
+
+    // Queued requests (including those made outside of a reservation) are
+    // returned to the queue, others are made of another channel.
+    for (const auto& hash: tracker_.release(node))
+    {
+        uint64_t height;
+        if (headers_first_ && headers_.find(height, hash))
+            headers_.release({ hash });
+        else
+            reassign(hash, node);
     }
-    
+
+    // Another channel may be idle and able to pick up the released hashes.
+    request_idle();
+}
+
+bool poller::track_block(const hash_digest& hash, channel::ptr node)
+{
+    const auto timeout = request_timeout(scores_.latency(node), 0);
+
+    if (!tracker_.request(hash, node, timeout))
+        return false;
+
+    scores_.requested(node, 1);
+    return true;
+}
+
+bool poller::request_block(const hash_digest& hash, channel::ptr node)
+{
+    if (!track_block(hash, node))
+        return false;
+
+    const get_data packet{ { inventory_type_id::block, hash } };
+
+    node->send(packet,
+        std::bind(&poller::handle_send_request,
+            this, _1, 1, node));
+
+    return true;
+}
+
+bool poller::requested(const hash_digest& hash) const
+{
+    return tracker_.requested(hash);
+}
+
+bool poller::queued(const hash_digest& hash) const
+{
+    uint64_t height;
+    return headers_first_ && headers_.find(height, hash);
+}
+
+peer_score::list poller::scores() const
+{
+    return scores_.scores();
+}
+
+void poller::handle_expired(const hash_digest& hash, channel::ptr node)
+{
+    log::debug(LOG_POLLER)
+        << "Block request expired [" << encode_hash(hash) << "] from ["
+        << node->authority() << "]";
+
+    // A channel that repeatedly stalls is dropped, which releases the rest of
+    // its requests.
+    if (scores_.stalled(node) >= stall_limit_)
+    {
+        log::debug(LOG_POLLER)
+            << "Dropping stalled channel [" << node->authority() << "]";
+        node->stop(error::channel_timeout);
+    }
+
+    dispatch_.ordered(
+        std::bind(&poller::reassign,
+            this, hash, node));
+}
+
+// Make an unanswered block request of another channel.
+void poller::reassign(const hash_digest& hash, channel::ptr node)
+{
+    uint64_t height;
+    unreserve(hash);
+
+    // Queued blocks are released so that the next available channel takes
+    // them, ahead of any higher unreserved blocks.
+    if (headers_first_ && headers_.find(height, hash))
+    {
+        headers_.release({ hash });
+        request_idle();
+        return;
+    }
+
+    const auto other = select_channel(node);
+
+    if (other)
+        request_block(hash, other);
+}
+
+// Remove the hash from every reservation that holds it.
+void poller::unreserve(const hash_digest& hash)
+{
+    for (auto& reservation: reservations_)
+    {
+        auto& hashes = reservation.second;
+        const auto it = std::find(hashes.begin(), hashes.end(), hash);
+
+        if (it == hashes.end())
+            continue;
+
+        hashes.erase(it);
+
+        // Give the channel more work once its reservation is exhausted.
+        if (hashes.empty())
+            request_reserved(reservation.first);
+    }
+}
+
+// Drop the queue above an invalid block, with the requests and buffered blocks
+// of the invalid branch, and ask every channel for headers so that a valid
+// branch may be found.
+void poller::invalidate(const hash_digest& hash, uint64_t height)
+{
+    cancel(headers_.ban(hash));
+    buffer_.initialize(height);
+
+    log::warning(LOG_POLLER)
+        << "Invalidated headers from #" << height << " ["
+        << encode_hash(hash) << "]";
+
+    for (const auto& reservation: reservations_)
+        request_headers(reservation.first);
+
+    request_idle();
+}
+
+// Remove the hashes from the request tracker and from every reservation.
+void poller::cancel(const hash_list& hashes)
+{
+    if (hashes.empty())
+        return;
+
+    const std::unordered_set<hash_digest> cancelled(hashes.begin(),
+        hashes.end());
+
+    for (const auto& hash: hashes)
+        tracker_.complete(hash);
+
+    for (auto& reservation: reservations_)
+    {
+        auto& reserved = reservation.second;
+        reserved.erase(std::remove_if(reserved.begin(), reserved.end(),
+            [&cancelled](const hash_digest& hash)
+            {
+                return cancelled.find(hash) != cancelled.end();
+            }), reserved.end());
+    }
+}
+
+// Select the channel other than the one excluded with the highest block rate
+// relative to its load. Unmeasured channels are selected by load alone.
+channel::ptr poller::select_channel(channel::ptr exclude) const
+{
+    channel::ptr selected;
+    auto best = 0.0;
+
+    for (const auto& reservation: reservations_)
+    {
+        if (reservation.first == exclude)
+            continue;
+
+        const auto rate = scores_.rate(reservation.first) + 1.0;
+        const auto value = rate / (reservation.second.size() + 1);
+
+        if (value > best)
+        {
+            selected = reservation.first;
+            best = value;
+        }
+    }
+
+    return selected;
+}
+
+void poller::request_blocks(const hash_digest& stop, channel::ptr node)
+{
+    // Headers replace the inventory round.
+    if (headers_first_ && stop == null_hash)
+    {
+        request_headers(node);
+        dispatch_.ordered(
+            std::bind(&poller::request_reserved,
+                this, node));
+        return;
+    }
+
+    // The locator is built from memory, without reading the database.
+    dispatch_.ordered(
+        std::bind(&poller::get_blocks,
+            this, index_.locator(), stop, node));
+}
+
+// Not having orphans will cause a stall unless mitigated.
+void poller::get_blocks(const block_locator& locator, const hash_digest& stop,
+    channel::ptr node)
+{
+    if (locator.empty())
+    {
+        log::debug(LOG_POLLER)
+            << "Chain index not loaded, skipping get blocks for ["
+            << node->authority() << "]";
+        return;
+    }
+
+    const auto start = locator.front();
+    const auto encoded = encode_hash(start);
+
     if (node->located(start, stop))
     {
         log::debug(LOG_POLLER)
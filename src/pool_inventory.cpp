@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/pool_inventory.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+pool_inventory::pool_inventory()
+{
+}
+
+void pool_inventory::store(const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hashes_.insert(hash);
+}
+
+void pool_inventory::remove(const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hashes_.erase(hash);
+}
+
+hash_list pool_inventory::hashes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hash_list(hashes_.begin(), hashes_.end());
+}
+
+size_t pool_inventory::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hashes_.size();
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/prevalidate.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::chain;
+
+// Consensus limits (mirrored from blockchain validation).
+static constexpr uint64_t max_block_size = 1000000;
+static constexpr uint32_t max_future_seconds = 2 * 60 * 60;
+
+bool is_valid_proof_of_work(const header& header)
+{
+    hash_number target;
+    if (!target.set_compact(header.bits))
+        return false;
+
+    hash_number value;
+    value.set_hash(header.hash());
+    return value <= target;
+}
+
+static bool is_futuristic(uint32_t timestamp)
+{
+    typedef std::chrono::system_clock clock;
+    const auto now = clock::to_time_t(clock::now());
+    return timestamp > static_cast<uint64_t>(now) + max_future_seconds;
+}
+
+// The merkle root of the transaction hashes, without rehashing transactions.
+static hash_digest merkle_root(hash_list hashes)
+{
+    while (hashes.size() > 1)
+    {
+        if (hashes.size() % 2 != 0)
+            hashes.push_back(hashes.back());
+
+        hash_list parents;
+        parents.reserve(hashes.size() / 2);
+
+        for (auto it = hashes.begin(); it != hashes.end(); it += 2)
+        {
+            data_chunk pair(it->begin(), it->end());
+            pair.insert(pair.end(), (it + 1)->begin(), (it + 1)->end());
+            parents.push_back(bitcoin_hash(pair));
+        }
+
+        hashes.swap(parents);
+    }
+
+    return hashes.empty() ? null_hash : hashes.front();
+}
+
+code prevalidate(const block& block)
+{
+    const auto& transactions = block.transactions;
+
+    if (transactions.empty() || block.serialized_size() > max_block_size)
+        return error::size_limits;
+
+    if (is_futuristic(block.header.timestamp))
+        return error::futuristic_timestamp;
+
+    if (!is_valid_proof_of_work(block.header))
+        return error::proof_of_work;
+
+    if (!transactions.front().is_coinbase())
+        return error::first_not_coinbase;
+
+    hash_list hashes;
+    hashes.reserve(transactions.size());
+    std::unordered_set<hash_digest> unique;
+
+    for (auto tx = transactions.begin(); tx != transactions.end(); ++tx)
+    {
+        if (tx != transactions.begin() && tx->is_coinbase())
+            return error::extra_coinbases;
+
+        if (tx->inputs.empty() || tx->outputs.empty())
+            return error::size_limits;
+
+        // Duplicates allow a mutated block to match the merkle root.
+        const auto hash = tx->hash();
+        if (!unique.insert(hash).second)
+            return error::duplicate;
+
+        hashes.push_back(hash);
+    }
+
+    if (merkle_root(std::move(hashes)) != block.header.merkle)
+        return error::merkle_mismatch;
+
+    return error::success;
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/raw_block.hpp>
+
+#include <cstdint>
+#include <string>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+const std::string raw_block::command = "block";
+
+raw_block::raw_block(const chain::block& block)
+  : hash_(block.header.hash()), data_(block.to_data())
+{
+}
+
+const hash_digest& raw_block::hash() const
+{
+    return hash_;
+}
+
+const data_chunk& raw_block::to_data() const
+{
+    return data_;
+}
+
+uint64_t raw_block::satoshi_size() const
+{
+    return data_.size();
+}
+
+} // namespace node
+} // namespace libbitcoin
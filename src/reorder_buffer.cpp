@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/reorder_buffer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::chain;
+using namespace bc::network;
+
+reorder_buffer::reorder_buffer(size_t capacity_bytes)
+  : capacity_(capacity_bytes),
+    bytes_(0),
+    next_height_(0)
+{
+}
+
+void reorder_buffer::initialize(uint64_t next_height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks_.clear();
+    bytes_ = 0;
+    next_height_ = next_height;
+}
+
+bool reorder_buffer::full() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_ >= capacity_;
+}
+
+size_t reorder_buffer::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size();
+}
+
+size_t reorder_buffer::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+uint64_t reorder_buffer::next_height() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_height_;
+}
+
+uint64_t reorder_buffer::top_height() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.empty() ? next_height_ - 1 : blocks_.rbegin()->first;
+}
+
+bool reorder_buffer::push(uint64_t height, const block& block,
+    channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (height < next_height_ || blocks_.find(height) != blocks_.end())
+        return false;
+
+    const auto size = static_cast<size_t>(block.serialized_size());
+    blocks_.emplace(height, entry{ block, node, size });
+    bytes_ += size;
+    return true;
+}
+
+bool reorder_buffer::pop(block& out_block, channel::ptr& out_node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = blocks_.find(next_height_);
+
+    if (it == blocks_.end())
+        return false;
+
+    out_block = it->second.block;
+    out_node = it->second.node;
+    bytes_ -= it->second.size;
+    blocks_.erase(it);
+    ++next_height_;
+    return true;
+}
+
+void reorder_buffer::truncate(uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto start = blocks_.upper_bound(height);
+
+    for (auto it = start; it != blocks_.end(); ++it)
+        bytes_ -= it->second.size;
+
+    blocks_.erase(start, blocks_.end());
+    next_height_ = std::min(next_height_, height + 1);
+}
+
+} // namespace node
+} // namespace libbitcoin
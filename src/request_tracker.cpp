@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/request_tracker.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::network;
+using std::placeholders::_1;
+
+// The interval at which requests are tested for expiration.
+static const auto sweep_interval = boost::posix_time::milliseconds(250);
+
+request_tracker::request_tracker(threadpool& pool, uint32_t timeout_seconds)
+  : pool_(pool),
+    timeout_(std::chrono::seconds(timeout_seconds))
+{
+}
+
+void request_tracker::start(expiry_handler handler)
+{
+    handle_expiry_ = handler;
+    timer_ = std::make_shared<deadline>(pool_, sweep_interval);
+    start_timer();
+}
+
+void request_tracker::stop()
+{
+    if (timer_)
+        timer_->stop();
+}
+
+void request_tracker::start_timer()
+{
+    timer_->start(
+        std::bind(&request_tracker::handle_timer,
+            this, _1));
+}
+
+void request_tracker::handle_timer(const code& ec)
+{
+    // The timer has been stopped.
+    if (ec)
+        return;
+
+    typedef std::pair<hash_digest, channel::ptr> expired_request;
+    std::vector<expired_request> expired;
+    const auto now = clock::now();
+
+    // Collect expired requests under the lock, handle them outside of it.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto it = requests_.begin(); it != requests_.end();)
+        {
+            if (it->second.deadline > now)
+            {
+                ++it;
+                continue;
+            }
+
+            expired.push_back(std::make_pair(it->first, it->second.node));
+            it = requests_.erase(it);
+        }
+    }
+
+    for (const auto& request: expired)
+        handle_expiry_(request.first, request.second);
+
+    start_timer();
+}
+
+bool request_tracker::request(const hash_digest& hash, channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const entry request{ node, clock::now() + timeout_ };
+    return requests_.emplace(hash, request).second;
+}
+
+bool request_tracker::request(const hash_digest& hash, channel::ptr node,
+    const duration& timeout)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const entry request{ node, clock::now() + timeout };
+    return requests_.emplace(hash, request).second;
+}
+
+bool request_tracker::requested(const hash_digest& hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_.find(hash) != requests_.end();
+}
+
+bool request_tracker::complete(const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_.erase(hash) != 0;
+}
+
+bool request_tracker::complete(const hash_digest& hash, channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = requests_.find(hash);
+
+    if (it == requests_.end() || it->second.node != node)
+        return false;
+
+    requests_.erase(it);
+    return true;
+}
+
+hash_list request_tracker::release(channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hash_list hashes;
+
+    for (auto it = requests_.begin(); it != requests_.end();)
+    {
+        if (it->second.node != node)
+        {
+            ++it;
+            continue;
+        }
+
+        hashes.push_back(it->first);
+        it = requests_.erase(it);
+    }
+
+    return hashes;
+}
+
+size_t request_tracker::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_.size();
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -19,9 +19,20 @@
  */
 #include <bitcoin/node/responder.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <system_error>
+#include <utility>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/block_cache.hpp>
+#include <bitcoin/node/bloom_filter.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/filtered_block.hpp>
+#include <bitcoin/node/raw_block.hpp>
 
 namespace libbitcoin {
 namespace node {
@@ -32,9 +43,27 @@ using namespace bc::blockchain;
 using namespace bc::message;
 using namespace bc::network;
 
-responder::responder(block_chain& blockchain, transaction_pool& tx_pool)
-  : blockchain_(blockchain), tx_pool_(tx_pool)
+static constexpr size_t megabyte = 1024 * 1024;
+
+// Blocks read from the store are cached only if within this depth of the top,
+// as historical blocks are requested once by each syncing peer.
+static constexpr uint64_t cache_depth = 144;
+
+// The number of get data items fetched ahead of the next reply to be sent.
+static constexpr size_t fetch_window = 16;
+
+responder::responder(block_chain& blockchain, chain_index& index,
+    sync_state& sync, transaction_pool& tx_pool,
+    uint32_t block_cache_megabytes)
+  : blockchain_(blockchain), index_(index), sync_(sync), tx_pool_(tx_pool),
+    cache_(block_cache_megabytes * megabyte)
+{
+}
+
+void responder::cache(const block_chain::list& blocks)
 {
+    for (const auto block: blocks)
+        cache_.store(std::make_shared<const raw_block>(*block));
 }
 
 void responder::monitor(channel::ptr node)
@@ -43,6 +72,138 @@ void responder::monitor(channel::ptr node)
     node->subscribe<get_data>(
         std::bind(&responder::receive_get_data,
             this, _1, _2, node));
+
+    // Subscribe to bloom filter changes.
+    node->subscribe<filter_load>(
+        std::bind(&responder::receive_filter_load,
+            this, _1, _2, node));
+
+    node->subscribe<filter_add>(
+        std::bind(&responder::receive_filter_add,
+            this, _1, _2, node));
+
+    node->subscribe<filter_clear>(
+        std::bind(&responder::receive_filter_clear,
+            this, _1, _2, node));
+
+    // Forget the channel's filter and continuation when it stops.
+    node->subscribe_stop(
+        std::bind(&responder::handle_stop,
+            this, _1, node));
+}
+
+responder::peer_filter::peer_filter(bloom_filter&& filter)
+  : filter(std::move(filter))
+{
+}
+
+void responder::receive_filter_load(const code& ec, const filter_load& packet,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    node->subscribe<filter_load>(
+        std::bind(&responder::receive_filter_load,
+            this, _1, _2, node));
+
+    bloom_filter filter(packet.filter, packet.hash_functions, packet.tweak,
+        packet.flags);
+
+    if (!filter.is_valid())
+    {
+        log::debug(LOG_RESPONDER)
+            << "Invalid bloom filter from [" << node->authority() << "]";
+        node->stop(error::bad_stream);
+        return;
+    }
+
+    log::debug(LOG_RESPONDER)
+        << "Bloom filter (" << filter.data().size() << ") bytes loaded by ["
+        << node->authority() << "]";
+
+    std::lock_guard<std::mutex> lock(filters_mutex_);
+    filters_[node] = std::make_shared<peer_filter>(std::move(filter));
+}
+
+void responder::receive_filter_add(const code& ec, const filter_add& packet,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    node->subscribe<filter_add>(
+        std::bind(&responder::receive_filter_add,
+            this, _1, _2, node));
+
+    const auto filter = find_filter(node);
+
+    // Adding to a filter that was never loaded is a protocol violation.
+    if (!filter || packet.data.size() > bloom_filter::max_element_bytes)
+    {
+        log::debug(LOG_RESPONDER)
+            << "Invalid bloom filter add from [" << node->authority() << "]";
+        node->stop(error::bad_stream);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(filter->mutex);
+    filter->filter.insert(packet.data);
+}
+
+void responder::receive_filter_clear(const code& ec, const filter_clear&,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    node->subscribe<filter_clear>(
+        std::bind(&responder::receive_filter_clear,
+            this, _1, _2, node));
+
+    std::lock_guard<std::mutex> lock(filters_mutex_);
+    filters_.erase(node);
+}
+
+void responder::handle_stop(const code&, channel::ptr node)
+{
+    {
+        std::lock_guard<std::mutex> lock(filters_mutex_);
+        filters_.erase(node);
+    }
+
+    std::lock_guard<std::mutex> lock(continuations_mutex_);
+    continuations_.erase(node);
+}
+
+void responder::set_continuation(channel::ptr node, const hash_digest& hash)
+{
+    std::lock_guard<std::mutex> lock(continuations_mutex_);
+    continuations_[node] = hash;
+}
+
+bool responder::filtered(channel::ptr node) const
+{
+    return find_filter(node) != nullptr;
+}
+
+bool responder::match(channel::ptr node, const transaction& tx,
+    const hash_digest& hash)
+{
+    const auto filter = find_filter(node);
+
+    if (!filter)
+        return true;
+
+    std::lock_guard<std::mutex> lock(filter->mutex);
+    return filter->filter.match(tx, hash);
+}
+
+responder::peer_filter::ptr responder::find_filter(channel::ptr node) const
+{
+    std::lock_guard<std::mutex> lock(filters_mutex_);
+    const auto it = filters_.find(node);
+    return it == filters_.end() ? nullptr : it->second;
 }
 
 // TODO: consolidate to libbitcoin utils.
@@ -86,56 +247,161 @@ void responder::receive_get_data(const code& ec, const get_data& packet,
         << "blocks (" << packet.count(inventory_type_id::block) << ") "
         << "bloom (" << packet.count(inventory_type_id::filtered_block) << ")";
 
-    for (const auto& inventory: packet.inventories)
+    const auto request = std::make_shared<data_request>(node,
+        packet.inventories);
+
+    dispatch(request);
+
+    log::debug(LOG_RESPONDER)
+        << "Getdata END [" << peer << "]";
+}
+
+// Items are fetched in a window that advances as replies are sent, which
+// bounds the replies held for a request. Only one thread dispatches for a
+// request at a time, so items answered without a fetch do not recurse.
+void responder::dispatch(data_request::ptr request)
+{
     {
-        switch (inventory.type)
+        std::lock_guard<std::mutex> lock(request->mutex);
+
+        if (request->dispatching)
+            return;
+
+        request->dispatching = true;
+    }
+
+    size_t index;
+    while (next_dispatch(request, index))
+        fetch_item(request, index);
+}
+
+bool responder::next_dispatch(data_request::ptr request, size_t& out_index)
+{
+    std::lock_guard<std::mutex> lock(request->mutex);
+    const auto end = std::min(request->replies.size(),
+        request->next + fetch_window);
+
+    if (request->dispatched >= end)
+    {
+        request->dispatching = false;
+        return false;
+    }
+
+    out_index = request->dispatched++;
+    return true;
+}
+
+void responder::fetch_item(data_request::ptr request, size_t index)
+{
+    const auto peer = request->node->authority();
+    const auto& inventory = request->replies[index].inventory;
+
+    switch (inventory.type)
+    {
+        case inventory_type_id::transaction:
+            log::debug(LOG_RESPONDER)
+                << "Transaction getdata for [" << peer << "] "
+                << encode_hash(inventory.hash);
+
+            // Block service takes priority over transaction lookups
+            // while the chain is in initial download.
+            if (sync_.initial_download())
+            {
+                complete(request, index, reply_state::missing);
+                break;
+            }
+
+            tx_pool_.fetch(inventory.hash,
+                std::bind(&responder::handle_pool_tx,
+                    this, _1, _2, request, index));
+            break;
+
+        case inventory_type_id::block:
+            log::debug(LOG_RESPONDER)
+                << "Block getdata for [" << peer << "] "
+                << encode_hash(inventory.hash);
+
+            // Unknown blocks are answered without reading the database.
+            if (!index_.exists(inventory.hash))
+            {
+                complete(request, index, reply_state::missing);
+                break;
+            }
+
+            // Recent blocks are served without reading the database.
+            if (const auto cached = cache_.find(inventory.hash))
+            {
+                request->replies[index].block = cached;
+                complete(request, index, reply_state::found);
+                break;
+            }
+
+            fetch_block(inventory.hash, request, index);
+            break;
+
+        case inventory_type_id::filtered_block:
         {
-            case inventory_type_id::transaction:
-                log::debug(LOG_RESPONDER)
-                    << "Transaction getdata for [" << peer << "] "
-                    << encode_hash(inventory.hash);
-                tx_pool_.fetch(inventory.hash,
-                    std::bind(&responder::send_pool_tx,
-                        this, _1, _2, inventory.hash, node));
+            log::debug(LOG_RESPONDER)
+                << "Filtered block getdata for [" << peer << "] "
+                << encode_hash(inventory.hash);
+
+            if (!index_.exists(inventory.hash))
+            {
+                complete(request, index, reply_state::missing);
                 break;
+            }
 
-            case inventory_type_id::block:
-                log::debug(LOG_RESPONDER)
-                    << "Block getdata for [" << peer << "] "
-                    << encode_hash(inventory.hash);
-                block_fetcher::fetch(blockchain_, inventory.hash,
-                    std::bind(&responder::send_block,
-                        this, _1, _2, inventory.hash, node));
+            // A filtered block is not sent to a peer without a filter.
+            if (!filtered(request->node))
+            {
+                complete(request, index, reply_state::ignored);
                 break;
+            }
 
-            case inventory_type_id::error:
-            case inventory_type_id::none:
-            default:
-                log::debug(LOG_RESPONDER)
-                    << "Ignoring invalid getdata type for [" << peer << "]";
+            block_fetcher::fetch(blockchain_, inventory.hash,
+                std::bind(&responder::handle_fetch_filtered,
+                    this, _1, _2, request, index));
+            break;
         }
+
+        case inventory_type_id::error:
+        case inventory_type_id::none:
+        default:
+            log::debug(LOG_RESPONDER)
+                << "Ignoring invalid getdata type for [" << peer << "]";
+            complete(request, index, reply_state::ignored);
     }
+}
 
-    log::debug(LOG_RESPONDER)
-        << "Getdata END [" << peer << "]";
+responder::data_request::data_request(channel::ptr node,
+    const inventory_vector::list& inventories)
+  : node(node), next(0), dispatched(0), dispatching(false)
+{
+    replies.reserve(inventories.size());
+
+    for (const auto& inventory: inventories)
+        replies.push_back(
+            { inventory, reply_state::pending, {}, nullptr, nullptr });
 }
 
-void responder::send_pool_tx(const code& ec, const transaction& tx,
-    const hash_digest& tx_hash, channel::ptr node)
+void responder::handle_pool_tx(const code& ec, const transaction& tx,
+    data_request::ptr request, size_t index)
 {
     if (ec == error::service_stopped)
         return;
 
+    const auto& hash = request->replies[index].inventory.hash;
+
     if (ec == error::not_found)
     {
         log::debug(LOG_RESPONDER)
-            << "Transaction for [" << node->authority()
-            << "] not in mempool [" << encode_hash(tx_hash) << "]";
+            << "Transaction for [" << request->node->authority()
+            << "] not in mempool [" << encode_hash(hash) << "]";
 
         // It wasn't in the mempool, so relay the request to the blockchain.
-        blockchain_.fetch_transaction(tx_hash,
-            std::bind(&responder::send_chain_tx,
-                this, _1, _2, tx_hash, node));
+        blockchain_.fetch_transaction(hash,
+            std::bind(&responder::handle_chain_tx,
+                this, _1, _2, request, index));
         return;
     }
 
@@ -143,12 +409,14 @@ void responder::send_pool_tx(const code& ec, const transaction& tx,
     {
         log::error(LOG_RESPONDER)
             << "Failure fetching mempool tx data for ["
-            << node->authority() << "] " << ec.message();
-        node->stop(ec);
+            << request->node->authority() << "] " << ec.message();
+        request->node->stop(ec);
+        complete(request, index, reply_state::ignored);
         return;
     }
 
-    send_tx(tx, tx_hash, node);
+    request->replies[index].tx = tx;
+    complete(request, index, reply_state::found);
 }
 
 // en.bitcoin.it/wiki/Protocol_documentation#getdata
@@ -156,8 +424,8 @@ void responder::send_pool_tx(const code& ec, const transaction& tx,
 // in the memory pool or relay set - arbitrary access to transactions
 // in the  chain is not allowed to avoid having clients start to depend
 // on nodes having full transaction indexes (which modern nodes do not).
-void responder::send_chain_tx(const code& ec, const transaction& tx,
-    const hash_digest& tx_hash, channel::ptr node)
+void responder::handle_chain_tx(const code& ec, const transaction& tx,
+    data_request::ptr request, size_t index)
 {
     if (ec == error::service_stopped)
         return;
@@ -165,11 +433,12 @@ void responder::send_chain_tx(const code& ec, const transaction& tx,
     if (ec == error::not_found)
     {
         log::debug(LOG_RESPONDER)
-            << "Transaction for [" << node->authority()
-            << "] not in blockchain [" << encode_hash(tx_hash) << "]";
+            << "Transaction for [" << request->node->authority()
+            << "] not in blockchain ["
+            << encode_hash(request->replies[index].inventory.hash) << "]";
 
-        // It wasn't in the blockchain, so send notfound.
-        send_tx_not_found(tx_hash, node);
+        // It wasn't in the blockchain, so it is reported as not found.
+        complete(request, index, reply_state::missing);
         return;
     }
 
@@ -177,12 +446,181 @@ void responder::send_chain_tx(const code& ec, const transaction& tx,
     {
         log::error(LOG_RESPONDER)
             << "Failure fetching blockchain tx data for ["
-            << node->authority() << "] " << ec.message();
-        node->stop(ec);
+            << request->node->authority() << "] " << ec.message();
+        request->node->stop(ec);
+        complete(request, index, reply_state::ignored);
+        return;
+    }
+
+    request->replies[index].tx = tx;
+    complete(request, index, reply_state::found);
+}
+
+// Concurrent requests for a block that is not cached share one read.
+void responder::fetch_block(const hash_digest& hash, data_request::ptr request,
+    size_t index)
+{
+    {
+        std::lock_guard<std::mutex> lock(block_fetches_mutex_);
+        auto& waiters = block_fetches_[hash];
+        waiters.push_back({ request, index });
+
+        if (waiters.size() > 1)
+            return;
+    }
+
+    block_fetcher::fetch(blockchain_, hash,
+        std::bind(&responder::handle_fetch_block,
+            this, _1, _2, hash));
+}
+
+void responder::handle_fetch_block(const code& ec, const block& block,
+    const hash_digest& hash)
+{
+    std::vector<block_waiter> waiters;
+
+    {
+        std::lock_guard<std::mutex> lock(block_fetches_mutex_);
+        const auto it = block_fetches_.find(hash);
+
+        if (it == block_fetches_.end())
+            return;
+
+        waiters.swap(it->second);
+        block_fetches_.erase(it);
+    }
+
+    if (ec == error::service_stopped)
+        return;
+
+    if (ec == error::not_found)
+    {
+        log::debug(LOG_RESPONDER)
+            << "Block not in blockchain [" << encode_hash(hash) << "]";
+
+        // It wasn't in the blockchain, so it is reported as not found.
+        for (const auto& waiter: waiters)
+            complete(waiter.request, waiter.index, reply_state::missing);
+
+        return;
+    }
+
+    if (ec)
+    {
+        log::error(LOG_RESPONDER)
+            << "Failure fetching block data [" << encode_hash(hash) << "] "
+            << ec.message();
+
+        for (const auto& waiter: waiters)
+        {
+            waiter.request->node->stop(ec);
+            complete(waiter.request, waiter.index, reply_state::ignored);
+        }
+
+        return;
+    }
+
+    const auto raw = std::make_shared<const raw_block>(block);
+    uint64_t height;
+
+    // Blocks near the top are likely to be requested by other peers.
+    if (index_.find(height, hash) && height + cache_depth >= index_.size())
+        cache_.store(raw);
+
+    for (const auto& waiter: waiters)
+    {
+        waiter.request->replies[waiter.index].block = raw;
+        complete(waiter.request, waiter.index, reply_state::found);
+    }
+}
+
+void responder::handle_fetch_filtered(const code& ec, const block& block,
+    data_request::ptr request, size_t index)
+{
+    if (ec == error::service_stopped)
+        return;
+
+    if (ec == error::not_found)
+    {
+        complete(request, index, reply_state::missing);
         return;
     }
 
-    send_tx(tx, tx_hash, node);
+    if (ec)
+    {
+        log::error(LOG_RESPONDER)
+            << "Failure fetching filtered block data for ["
+            << request->node->authority() << "] " << ec.message();
+        request->node->stop(ec);
+        complete(request, index, reply_state::ignored);
+        return;
+    }
+
+    // The block is matched when its reply is sent, in request order.
+    request->replies[index].filtered = std::make_shared<const chain::block>(
+        block);
+    complete(request, index, reply_state::found);
+}
+
+// Replies are sent in the order requested, so each completed reply is sent
+// once all replies before it have been. Sends are made under the request
+// lock so that they are queued to the channel in order. Items that were not
+// found are reported together once the request is complete.
+void responder::complete(data_request::ptr request, size_t index,
+    reply_state state)
+{
+    {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        auto& replies = request->replies;
+        replies[index].state = state;
+
+        for (; request->next < replies.size() &&
+            replies[request->next].state != reply_state::pending;
+            ++request->next)
+        {
+            auto& reply = replies[request->next];
+
+            if (reply.state == reply_state::missing)
+                request->missing.inventories.push_back(reply.inventory);
+
+            if (reply.state != reply_state::found)
+                continue;
+
+            if (reply.inventory.type == inventory_type_id::transaction)
+                send_tx(reply.tx, reply.inventory.hash, request->node);
+            else if (reply.inventory.type ==
+                inventory_type_id::filtered_block)
+            {
+                // A filter cleared since the request ends the reply.
+                const auto filter = find_filter(request->node);
+
+                if (filter)
+                    send_filtered_block(*reply.filtered, filter,
+                        request->node);
+            }
+            else
+                send_raw_block(reply.block, request->node);
+
+            if (reply.inventory.type != inventory_type_id::transaction)
+                send_continuation(reply.inventory.hash, request->node);
+
+            // Release the reply once it has been handed to the channel.
+            reply.tx = transaction();
+            reply.block.reset();
+            reply.filtered.reset();
+        }
+
+        const auto done = request->next == replies.size();
+
+        if (done && !request->missing.inventories.empty())
+        {
+            send_not_found(request->missing, request->node);
+            request->missing.inventories.clear();
+        }
+    }
+
+    // The sent replies open the window to further fetches.
+    dispatch(request);
 }
 
 void responder::send_tx(const transaction& tx, const hash_digest& hash,
@@ -203,95 +641,108 @@ void responder::send_tx(const transaction& tx, const hash_digest& hash,
     node->send(tx, send_handler);
 }
 
-void responder::send_tx_not_found(const hash_digest& hash, channel::ptr node)
+// The block is written from its serialization, which may be shared.
+void responder::send_raw_block(raw_block::ptr block, channel::ptr node)
 {
-    const auto send_handler = [hash, node](const code& ec)
+    const auto send_handler = [block, node](const code& ec)
     {
         if (ec)
             log::debug(LOG_RESPONDER)
-                << "Failure sending tx notfound for ["
+                << "Failure sending block for ["
                 << node->authority() << "]";
         else
             log::debug(LOG_RESPONDER)
-                << "Sent tx notfound for [" << node->authority()
-                << "] " << encode_hash(hash);
+                << "Sent block for [" << node->authority()
+                << "] " << encode_hash(block->hash());
     };
 
-    send_inventory_not_found(inventory_type_id::transaction, hash, node,
-        send_handler);
+    node->send(*block, send_handler);
 }
 
-// Should we look in the orphan pool first?
-void responder::send_block(const code& ec, const block& block,
-    const hash_digest& block_hash, channel::ptr node)
+// A peer that has been sent the last block of a full get blocks response is
+// sent the chain top, so that it continues with another get blocks request.
+void responder::send_continuation(const hash_digest& hash, channel::ptr node)
 {
-    if (ec == error::service_stopped)
-        return;
-
-    if (ec == error::not_found)
     {
-        log::debug(LOG_RESPONDER)
-            << "Block for [" << node->authority()
-            << "] not in blockchain [" << encode_hash(block_hash) << "]";
+        std::lock_guard<std::mutex> lock(continuations_mutex_);
+        const auto it = continuations_.find(node);
 
-        // It wasn't in the blockchain, so send notfound.
-        send_block_not_found(block_hash, node);
-    }
+        if (it == continuations_.end() || it->second != hash)
+            return;
 
-    if (ec)
-    {
-        log::error(LOG_RESPONDER)
-            << "Failure fetching block data for ["
-            << node->authority() << "] " << ec.message();
-        node->stop(ec);
-        return;
+        continuations_.erase(it);
     }
 
-    const auto send_handler = [block_hash, node](const code& ec)
+    const auto top = index_.top_hash();
+    const auto send_handler = [top, node](const code& ec)
     {
         if (ec)
             log::debug(LOG_RESPONDER)
-                << "Failure sending block for ["
+                << "Failure sending continuation for ["
                 << node->authority() << "]";
         else
             log::debug(LOG_RESPONDER)
-                << "Sent block for [" << node->authority()
-                << "] " << encode_hash(block_hash);
+                << "Sent continuation for [" << node->authority()
+                << "] " << encode_hash(top);
     };
 
-    node->send(block, send_handler);
+    inventory packet;
+    packet.inventories.push_back({ inventory_type_id::block, top });
+    node->send(packet, send_handler);
 }
 
-void responder::send_block_not_found(const hash_digest& block_hash,
-    channel::ptr node)
+// The merkle block is followed by the matched transactions (BIP37). Matching
+// updates the filter, so blocks are matched one at a time and in the order
+// that they were requested, as they are sent.
+void responder::send_filtered_block(const block& block,
+    peer_filter::ptr filter, channel::ptr node)
 {
-    const auto send_handler = [block_hash, node](const code& ec)
+    std::shared_ptr<const filtered_block> merkle;
+
+    {
+        std::lock_guard<std::mutex> lock(filter->mutex);
+        merkle = std::make_shared<const filtered_block>(block,
+            filter->filter);
+    }
+
+    const auto hash = block.header.hash();
+    const auto send_handler = [hash, node](const code& ec)
     {
         if (ec)
             log::debug(LOG_RESPONDER)
-                << "Failure sending block notfound for ["
+                << "Failure sending merkle block for ["
                 << node->authority() << "]";
         else
             log::debug(LOG_RESPONDER)
-                << "Sent block notfound for [" << node->authority()
-                << "] " << encode_hash(block_hash);
+                << "Sent merkle block for [" << node->authority()
+                << "] " << encode_hash(hash);
     };
 
-    send_inventory_not_found(inventory_type_id::block, block_hash,
-        node, send_handler);
+    node->send(*merkle, send_handler);
+
+    for (const auto position: merkle->matches())
+    {
+        const auto& tx = block.transactions[position];
+        send_tx(tx, tx.hash(), node);
+    }
 }
 
-void responder::send_inventory_not_found(inventory_type_id type_id,
-    const hash_digest& hash, channel::ptr node, proxy::result_handler handler)
+void responder::send_not_found(const not_found& packet, channel::ptr node)
 {
-    const inventory_vector block_inventory
+    const auto count = packet.inventories.size();
+    const auto send_handler = [count, node](const code& ec)
     {
-        type_id,
-        hash
+        if (ec)
+            log::debug(LOG_RESPONDER)
+                << "Failure sending notfound for ["
+                << node->authority() << "]";
+        else
+            log::debug(LOG_RESPONDER)
+                << "Sent notfound (" << count << ") for ["
+                << node->authority() << "]";
     };
 
-    const not_found lost{ { block_inventory } };
-    node->send(lost, handler);
+    node->send(packet, send_handler);
 }
 
 } // node
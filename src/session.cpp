@@ -19,11 +19,18 @@
  */
 #include <bitcoin/node/session.hpp>
 
+#include <algorithm>
 #include <future>
+#include <memory>
 #include <system_error>
 #include <bitcoin/blockchain.hpp>
+#include <bitcoin/node/announcer.hpp>
+#include <bitcoin/node/chain_index.hpp>
+#include <bitcoin/node/configuration.hpp>
 #include <bitcoin/node/full_node.hpp>
 #include <bitcoin/node/poller.hpp>
+#include <bitcoin/node/pool_inventory.hpp>
+#include <bitcoin/node/request_tracker.hpp>
 #include <bitcoin/node/responder.hpp>
 
 namespace libbitcoin {
@@ -38,22 +45,43 @@ using namespace bc::blockchain;
 using namespace bc::message;
 using namespace bc::network;
 
+// The protocol limit on the number of inventories in a get blocks response.
+static constexpr size_t max_get_blocks = 500;
+
+// The protocol limit on the number of headers in a get headers response.
+static constexpr size_t max_get_headers = 2000;
+
+// The protocol limit on the number of inventories in an inventory message.
+static constexpr size_t max_inventory = 50000;
+
+// The service bit of peers that answer mempool requests (BIP111).
+static constexpr uint64_t node_bloom = 1u << 2;
+
 session::session(threadpool& pool, p2p& network, block_chain& blockchain,
-    poller& poller, transaction_pool& transaction_pool, responder& responder,
-    size_t last_checkpoint_height)
+    chain_index& index, poller& poller, sync_state& sync,
+    transaction_pool& transaction_pool, pool_inventory& pool_inventory,
+    responder& responder, announcer& announcer, const configuration& config)
   : dispatch_(pool),
     network_(network),
     blockchain_(blockchain),
+    index_(index),
     tx_pool_(transaction_pool),
+    pool_inventory_(pool_inventory),
     poller_(poller),
+    sync_(sync),
     responder_(responder),
-    last_height_(0),
-    last_checkpoint_height_(last_checkpoint_height)
+    announcer_(announcer),
+    tx_tracker_(pool, config.node.transaction_timeout_seconds),
+    request_mempool_(config.node.request_mempool)
 {
 }
 
 void session::start()
 {
+    tx_tracker_.start(
+        std::bind(&session::handle_tx_expired,
+            this, _1, _2));
+
     // Subscribe to new connections.
     network_.subscribe(
         std::bind(&session::new_channel,
@@ -65,31 +93,20 @@ void session::start()
             this, _1, _2, _3, _4));
 }
 
+void session::stop()
+{
+    tx_tracker_.stop();
+}
+
 void session::new_channel(const code& ec, channel::ptr node)
 {
     // This is the sentinel code for protocol stopping (and node is nullptr).
     if (ec == error::service_stopped)
         return;
 
-    const auto revive = [this, node](const code ec)
-    {
-        if (ec)
-        {
-            log::error(LOG_SESSION)
-                << "Failure in channel revival: " << ec.message();
-            return;
-        }
+    // The height advertised in the handshake contributes to the sync target.
+    sync_.add_peer(node, node->version().start_height);
 
-        log::debug(LOG_SESSION)
-            << "Channel revived [" << node->authority() << "]";
-
-        // Send an inv request for 500 blocks.
-        poller_.request_blocks(null_hash, node);
-    };
-
-    // Revive channel with a new getblocks request if it stops getting blocks.
-    node->set_revival_handler(revive);
-    
     // Subscribe to new inventory requests.
     node->subscribe<inventory>(
         std::bind(&session::receive_inv,
@@ -100,6 +117,32 @@ void session::new_channel(const code& ec, channel::ptr node)
         std::bind(&session::receive_get_blocks,
             this, _1, _2, node));
 
+    // Subscribe to new get_headers requests.
+    node->subscribe<get_headers>(
+        std::bind(&session::receive_get_headers,
+            this, _1, _2, node));
+
+    // Subscribe to not found replies to our transaction requests.
+    node->subscribe<not_found>(
+        std::bind(&session::receive_not_found,
+            this, _1, _2, node));
+
+    // Subscribe to mempool requests.
+    node->subscribe<memory_pool>(
+        std::bind(&session::receive_memory_pool,
+            this, _1, _2, node));
+
+    // Ask the peer for its memory pool once the chain is synced.
+    if (request_mempool_ && (node->version().services & node_bloom) != 0)
+        dispatch_.ordered(
+            std::bind(&session::add_mempool_peer,
+                this, node));
+
+    // Forget the channel's requests when it stops.
+    node->subscribe_stop(
+        std::bind(&session::handle_channel_stop,
+            this, _1, node));
+
     // Resubscribe to new channels.
     network_.subscribe(
         std::bind(&session::new_channel,
@@ -110,6 +153,9 @@ void session::new_channel(const code& ec, channel::ptr node)
 
     // Respond to get data requests on this channel.
     responder_.monitor(node);
+
+    // Track the inventory known to this channel.
+    announcer_.monitor(node);
 }
 
 void session::handle_new_blocks(const code& ec, uint64_t fork_point,
@@ -140,43 +186,31 @@ void session::handle_new_blocks(const code& ec, uint64_t fork_point,
         std::bind(&session::handle_new_blocks,
             this, _1, _2, _3, _4));
 
-    // Don't bother publishing blocks when in the initial blockchain download.
-    if (fork_point < last_checkpoint_height_)
+    if (!new_blocks.empty())
+        sync_.set_top(height, new_blocks.back()->header.timestamp);
+
+    // Blocks are only announced once the chain has caught up.
+    if (!sync_.synced())
         return;
 
-    // Broadcast new blocks inventory.
-    inventory blocks_inventory;
+    // Announced blocks are cached as most peers will request them.
+    responder_.cache(new_blocks);
+
+    chain::header::list headers;
 
     for (const auto block: new_blocks)
-    {
-        const inventory_vector inventory
-        {
-            inventory_type_id::block,
-            block->header.hash()
-        };
+        headers.push_back(block->header);
 
-        blocks_inventory.inventories.push_back(inventory);
-    }
+    // Announcements are coalesced, and channels that announced or sent a
+    // block are not sent it again.
+    announcer_.announce_blocks(headers);
 
     log::debug(LOG_SESSION)
-        << "Broadcasting block inventory [" 
-        << blocks_inventory.inventories.size() << "]";
-
-    const auto broadcast_handler = [](const code ec, channel::ptr node)
-    {
-        if (ec)
-            log::debug(LOG_SESSION)
-                << "Failure broadcasting block inventory to ["
-                << node->authority() << "] " << ec.message();
-        else
-            log::debug(LOG_SESSION)
-                << "Broadcasted block inventory to ["
-                << node->authority() << "] ";
-    };
+        << "Queued block announcement [" << headers.size() << "]";
 
-    // Could optimize by not broadcasting to the node from which it came.
-    const auto unhandled = [](const code){};
-    network_.broadcast(blocks_inventory, broadcast_handler, unhandled);
+    dispatch_.ordered(
+        std::bind(&session::request_mempools,
+            this));
 }
 
 // Put this on a short timer following lack of block inv.
@@ -209,41 +243,47 @@ void session::receive_inv(const code& ec, const inventory& packet,
         << "blocks (" << packet.count(inventory_type_id::block) << ") "
         << "bloom (" << packet.count(inventory_type_id::filtered_block) << ")";
 
-    // TODO: build an inventory vector vs. individual requests.
-    // See commented out (redundant) code in poller.cpp.
+    inventory_vector::list candidates;
+
     for (const auto& inventory: packet.inventories)
     {
         switch (inventory.type)
         {
             case inventory_type_id::transaction:
-                if (last_height_ >= last_checkpoint_height_)
-                {
-                    log::debug(LOG_SESSION)
-                        << "Transaction inventory from [" << peer << "] "
-                        << encode_hash(inventory.hash);
-
-                    dispatch_.ordered(
-                        std::bind(&session::new_tx_inventory,
-                            this, inventory.hash, node));
-                }
+                // No memory pool work is done until the chain is synced.
+                if (sync_.synced())
+                    candidates.push_back(inventory);
                 else
                     log::debug(LOG_SESSION)
                         << "Ignoring premature transaction inventory from ["
                         << peer << "]";
-
                 break;
 
             case inventory_type_id::block:
-                log::debug(LOG_SESSION)
-                    << "Block inventory from [" << peer << "] for ["
-                    << encode_hash(inventory.hash) << "]";
-                dispatch_.ordered(
-                    std::bind(&session::new_block_inventory,
-                        this, inventory.hash, node));
+                // Most block announcements are of blocks we already have.
+                if (index_.exists(inventory.hash))
+                {
+                    log::debug(LOG_SESSION)
+                        << "Block already exists ["
+                        << encode_hash(inventory.hash) << "]";
+                }
+                else if (poller_.queued(inventory.hash))
+                {
+                    // Queued blocks are downloaded by the poller.
+                    log::debug(LOG_SESSION)
+                        << "Block already queued ["
+                        << encode_hash(inventory.hash) << "]";
+                }
+                else if (!poller_.requested(inventory.hash))
+                {
+                    // Don't ask for a block in flight from any channel.
+                    candidates.push_back(inventory);
+                }
+
                 break;
 
             case inventory_type_id::filtered_block:
-                // We don't suppport bloom filters, so we shouldn't see this.
+                // Filtered blocks are requested, not announced (BIP37).
                 log::debug(LOG_SESSION)
                     << "Ignoring filtered block inventory from ["
                     << peer << "] " << encode_hash(inventory.hash);
@@ -258,138 +298,249 @@ void session::receive_inv(const code& ec, const inventory& packet,
     }
 
     log::debug(LOG_SESSION)
-        << "Inventory END [" << peer << "]";
+        << "Inventory END [" << peer << "] candidates ("
+        << candidates.size() << ")";
+
+    if (candidates.empty())
+        return;
+
+    // All existence tests join on a single get data request.
+    const auto request = std::make_shared<data_request>();
+    request->pending = candidates.size();
+
+    for (const auto& inventory: candidates)
+    {
+        if (inventory.type == inventory_type_id::transaction)
+            tx_pool_.exists(inventory.hash,
+                std::bind(&session::handle_tx_exists,
+                    this, _1, inventory, request, node));
+        else
+            dispatch_.ordered(
+                std::bind(&session::add_inventory,
+                    this, inventory, true, request, node));
+    }
 }
 
-void session::new_tx_inventory(const hash_digest& hash, channel::ptr node)
+void session::handle_tx_exists(const code& ec,
+    const inventory_vector& inventory, data_request::ptr request,
+    channel::ptr node)
 {
-    // If the tx doesn't exist in our mempool, issue getdata.
-    tx_pool_.exists(hash,
-        std::bind(&session::request_tx_data,
-            this, _1, hash, node));
+    const auto missing = (ec == error::not_found);
+
+    if (ec && !missing && ec != error::service_stopped)
+        log::debug(LOG_SESSION)
+            << "Failure in getting transaction existence ["
+            << encode_hash(inventory.hash) << "] " << ec.message();
+
+    dispatch_.ordered(
+        std::bind(&session::add_inventory,
+            this, inventory, missing, request, node));
 }
 
-void session::request_tx_data(const code& ec, const hash_digest& hash,
+void session::add_inventory(const inventory_vector& inventory, bool missing,
+    data_request::ptr request, channel::ptr node)
+{
+    // The poller tracks block requests so that no other channel is asked for
+    // the block until this request is answered or expires.
+    if (missing && inventory.type == inventory_type_id::block &&
+        !poller_.queued(inventory.hash) &&
+        poller_.track_block(inventory.hash, node))
+        request->packet.inventories.push_back(inventory);
+
+    // A transaction is requested of one channel at a time, other channels
+    // that announce it are asked in turn if that request fails.
+    if (missing && inventory.type == inventory_type_id::transaction)
+    {
+        if (tx_tracker_.request(inventory.hash, node))
+            request->packet.inventories.push_back(inventory);
+        else
+            add_tx_announcer(inventory.hash, node);
+    }
+
+    if (--request->pending == 0)
+        send_data_request(request->packet, node);
+}
+
+void session::add_tx_announcer(const hash_digest& hash, channel::ptr node)
+{
+    auto& announcers = tx_announcers_[hash];
+
+    if (std::find(announcers.begin(), announcers.end(), node) ==
+        announcers.end())
+        announcers.push_back(node);
+}
+
+void session::received_tx(const hash_digest& hash)
+{
+    tx_tracker_.complete(hash);
+
+    dispatch_.ordered(
+        std::bind(&session::remove_tx_announcers,
+            this, hash));
+}
+
+void session::remove_tx_announcers(const hash_digest& hash)
+{
+    tx_announcers_.erase(hash);
+}
+
+void session::receive_not_found(const code& ec, const not_found& packet,
     channel::ptr node)
 {
-    if (ec == error::channel_stopped)
+    if (ec)
         return;
 
-    const auto encoded = encode_hash(hash);
+    // Resubscribe to not found replies.
+    node->subscribe<not_found>(
+        std::bind(&session::receive_not_found,
+            this, _1, _2, node));
 
-    if (ec == error::success)
-    {
-        log::debug(LOG_SESSION)
-            << "Transaction already exists [" << encoded << "]";
+    for (const auto& inventory: packet.inventories)
+        if (inventory.type == inventory_type_id::transaction &&
+            tx_tracker_.complete(inventory.hash, node))
+            dispatch_.ordered(
+                std::bind(&session::request_tx_fallback,
+                    this, inventory.hash));
+}
+
+void session::handle_tx_expired(const hash_digest& hash, channel::ptr node)
+{
+    log::debug(LOG_SESSION)
+        << "Transaction request expired [" << encode_hash(hash) << "] from ["
+        << node->authority() << "]";
+
+    dispatch_.ordered(
+        std::bind(&session::request_tx_fallback,
+            this, hash));
+}
+
+// Request the transaction of the next channel that announced it.
+void session::request_tx_fallback(const hash_digest& hash)
+{
+    const auto it = tx_announcers_.find(hash);
+
+    if (it == tx_announcers_.end())
         return;
-    }
 
-    if (ec != error::not_found)
+    auto& announcers = it->second;
+
+    while (!announcers.empty())
     {
+        const auto node = announcers.front();
+        announcers.pop_front();
+
+        if (!tx_tracker_.request(hash, node))
+            continue;
+
         log::debug(LOG_SESSION)
-            << "Failure in getting transaction existence [" << encoded << "] "
-            << ec.message();
-        return;
+            << "Requesting transaction [" << encode_hash(hash)
+            << "] from alternate [" << node->authority() << "]";
+
+        send_data_request({ { inventory_type_id::transaction, hash } }, node);
+        break;
     }
 
-    // ec == error::not_found
+    if (announcers.empty())
+        tx_announcers_.erase(it);
+}
 
-    const auto handle_error = [node, hash](const code ec)
+void session::send_data_request(const get_data& packet, channel::ptr node)
+{
+    if (packet.inventories.empty())
+        return;
+
+    const auto handle_error = [node](const code ec)
     {
         if (ec)
         {
             log::debug(LOG_SESSION)
-                << "Failure sending tx [" << encode_hash(hash)
-                << "] request to [" << node->authority() << "] "
-                << ec.message();
+                << "Failure sending get data to [" << node->authority()
+                << "] " << ec.message();
             node->stop(ec);
-            return;
         }
     };
 
+    const auto blocks = packet.count(inventory_type_id::block);
+
     log::debug(LOG_SESSION)
-        << "Requesting transaction [" << encoded << "]";
+        << "Requesting txs (" << packet.count(inventory_type_id::transaction)
+        << ") blocks (" << blocks << ") from [" << node->authority() << "]";
 
-    const get_data packet{ { inventory_type_id::transaction, hash } };
     node->send(packet, handle_error);
 }
 
-void session::new_block_inventory(const hash_digest& hash, channel::ptr node)
+void session::receive_get_blocks(const code& ec, const get_blocks& packet,
+    channel::ptr node)
 {
-    const auto request_block = [this, hash, node]
-        (const code ec, const block block)
-    {
-        if (ec == error::not_found)
-        {
-            dispatch_.ordered(
-                std::bind(&session::request_block_data,
-                    this, hash, node));
-            return;
-        }
-
-        if (ec)
-        {
-            log::error(LOG_SESSION)
-                << "Failure fetching block ["
-                << encode_hash(hash) << "] " << ec.message();
-            node->stop(ec);
-            return;
-        }
+    if (ec == error::channel_stopped)
+        return;
 
+    if (ec)
+    {
         log::debug(LOG_SESSION)
-            << "Block already exists [" << encode_hash(hash) << "]";
-    };
+            << "Failure in get blocks [" << node->authority() << "] "
+            << ec.message();
+        node->stop(ec);
+        return;
+    }
+
+    // Resubscribe to new get_blocks requests.
+    node->subscribe<get_blocks>(
+        std::bind(&session::receive_get_blocks,
+            this, _1, _2, node));
 
-    // TODO: optimize with chain_.block_exists(block_hash, handler) function.
-    // If the block doesn't exist, issue getdata for block.
-    block_fetcher::fetch(blockchain_, hash, request_block);
+    dispatch_.ordered(
+        std::bind(&session::send_block_inventory,
+            this, packet, node));
 }
 
-void session::request_block_data(const hash_digest& hash, channel::ptr node)
+// The locator is resolved against the chain index, without database reads.
+void session::send_block_inventory(const get_blocks& packet,
+    channel::ptr node)
 {
+    const auto start = index_.fork_height(packet.start_hashes) + 1;
+    const auto hashes = index_.hashes(start, packet.hash_stop,
+        max_get_blocks);
+
+    if (hashes.empty())
+    {
+        log::debug(LOG_SESSION)
+            << "No blocks for get blocks from [" << node->authority()
+            << "] at #" << start;
+        return;
+    }
+
+    inventory reply;
+    reply.inventories.reserve(hashes.size());
+
+    for (const auto& hash: hashes)
+        reply.inventories.push_back({ inventory_type_id::block, hash });
+
+    announcer_.mark(node, reply.inventories);
+
+    // A full response is continued once the peer asks for its last block.
+    if (hashes.size() == max_get_blocks)
+        responder_.set_continuation(node, hashes.back());
+
     log::debug(LOG_SESSION)
-        << "Requesting block [" << encode_hash(hash) << "] from ["
-        << node->authority() << "]";
+        << "Sending block inventory (" << hashes.size() << ") to ["
+        << node->authority() << "] from #" << start;
 
-    const auto handle_error = [node, hash](const code ec)
+    const auto handle_error = [node](const code ec)
     {
         if (ec)
         {
             log::debug(LOG_SESSION)
-                << "Failure requesting block data [" << encode_hash(hash)
-                << "] from [" << node->authority() << "] " << ec.message();
+                << "Failure sending block inventory to ["
+                << node->authority() << "] " << ec.message();
             node->stop(ec);
-            return;
         }
-
-        log::debug(LOG_SESSION)
-            << "Sent block request [" << encode_hash(hash) << "] to ["
-            << node->authority() << "]";
     };
 
-    const get_data packet{ { inventory_type_id::block, hash } };
-    node->send(packet, handle_error);
-
-    // Reset the revival timer because we just asked for block data. If after
-    // the last revival-initiated inventory request we didn't receive any block
-    // inv then this will not restart the timer and we will no longer revive
-    // this channel.
-    //
-    // The presumption is that we are then at the top of our peer's chain, or
-    // the peer has delayed but will eventually send us more block inventory, 
-    // thereby restarting the revival timer.
-    //
-    // If we have not sent a block inv request because the current inv request
-    // is the same as the last then this may stall. So we skip a duplicate
-    // request only if the last request was not a null_hash stop (500).
-    //
-    // If the peer is just unresponsive but we are not at its top, we will end
-    // up timing out or expiring the channel.
-    node->reset_revival();
+    node->send(reply, handle_error);
 }
 
-// TODO: We don't currently respond to peers making getblocks requests.
-void session::receive_get_blocks(const code& ec, const get_blocks& get_blocks,
+void session::receive_get_headers(const code& ec, const get_headers& packet,
     channel::ptr node)
 {
     if (ec == error::channel_stopped)
@@ -398,23 +549,146 @@ void session::receive_get_blocks(const code& ec, const get_blocks& get_blocks,
     if (ec)
     {
         log::debug(LOG_SESSION)
-            << "Failure in get blocks [" << node->authority() << "] "
+            << "Failure in get headers [" << node->authority() << "] "
             << ec.message();
         node->stop(ec);
         return;
     }
 
-    ///////////////////////////////////////////////////////////////////////////
-    // TODO: Implement.
-    ///////////////////////////////////////////////////////////////////////////
-    log::info(LOG_SESSION)
-        << "Received a get blocks request (IGNORED).";
-
-    // This is disabled to prevent logging subsequent requests on this channel.
-    ////// Resubscribe to new get_blocks requests.
-    ////node->subscribe_get_blocks(
-    ////    std::bind(&session::handle_get_blocks,
-    ////        this, _1, _2, node));
+    // Resubscribe to new get_headers requests.
+    node->subscribe<get_headers>(
+        std::bind(&session::receive_get_headers,
+            this, _1, _2, node));
+
+    uint64_t start;
+    const auto& locator = packet.start_hashes;
+
+    // An empty locator requests only the header of the stop hash.
+    if (locator.empty())
+    {
+        if (!index_.find(start, packet.hash_stop))
+            return;
+    }
+    else
+        start = index_.fork_height(locator) + 1;
+
+    // Headers are served from the chain index, without database reads.
+    headers reply;
+    reply.elements = index_.headers(start, packet.hash_stop, max_get_headers);
+
+    log::debug(LOG_SESSION)
+        << "Sending headers (" << reply.elements.size() << ") to ["
+        << node->authority() << "] from #" << start;
+
+    const auto handle_error = [node](const code ec)
+    {
+        if (ec)
+        {
+            log::debug(LOG_SESSION)
+                << "Failure sending headers to [" << node->authority()
+                << "] " << ec.message();
+            node->stop(ec);
+        }
+    };
+
+    node->send(reply, handle_error);
+}
+
+// Answer a mempool request (BIP35) with the pool inventory in pages.
+void session::receive_memory_pool(const code& ec, const memory_pool&,
+    channel::ptr node)
+{
+    if (ec)
+        return;
+
+    // Resubscribe to mempool requests.
+    node->subscribe<memory_pool>(
+        std::bind(&session::receive_memory_pool,
+            this, _1, _2, node));
+
+    const auto hashes = pool_inventory_.hashes();
+    size_t sent = 0;
+
+    for (auto it = hashes.begin(); it != hashes.end();)
+    {
+        const auto count = std::min(max_inventory,
+            static_cast<size_t>(hashes.end() - it));
+
+        inventory page;
+        page.inventories.reserve(count);
+
+        for (const auto end = it + count; it != end; ++it)
+            page.inventories.push_back(
+                { inventory_type_id::transaction, *it });
+
+        // Transactions known to the channel are not announced again.
+        sent += announcer_.announce(node, page);
+    }
+
+    log::debug(LOG_SESSION)
+        << "Mempool inventory (" << sent << ") of (" << hashes.size()
+        << ") for [" << node->authority() << "]";
+}
+
+void session::add_mempool_peer(channel::ptr node)
+{
+    mempool_peers_.insert(node);
+    request_mempools();
+}
+
+// Each peer is asked once, as soon as the chain is synced.
+void session::request_mempools()
+{
+    if (mempool_peers_.empty() || !sync_.synced())
+        return;
+
+    for (const auto node: mempool_peers_)
+    {
+        const auto handle_send = [node](const code ec)
+        {
+            if (ec)
+                log::debug(LOG_SESSION)
+                    << "Failure sending mempool request to ["
+                    << node->authority() << "] " << ec.message();
+        };
+
+        log::debug(LOG_SESSION)
+            << "Requesting mempool from [" << node->authority() << "]";
+
+        node->send(memory_pool(), handle_send);
+    }
+
+    mempool_peers_.clear();
+}
+
+void session::handle_channel_stop(const code&, channel::ptr node)
+{
+    sync_.remove_peer(node);
+
+    dispatch_.ordered(
+        std::bind(&session::remove_channel,
+            this, node));
+}
+
+void session::remove_channel(channel::ptr node)
+{
+    mempool_peers_.erase(node);
+
+    for (auto it = tx_announcers_.begin(); it != tx_announcers_.end();)
+    {
+        auto& announcers = it->second;
+        announcers.erase(std::remove(announcers.begin(), announcers.end(),
+            node), announcers.end());
+
+        if (announcers.empty())
+            it = tx_announcers_.erase(it);
+        else
+            ++it;
+    }
+
+    // Transactions in flight from the channel are asked of another.
+    for (const auto& hash: tx_tracker_.release(node))
+        request_tx_fallback(hash);
 }
 
 } // namespace node
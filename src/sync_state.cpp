@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/sync_state.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+using namespace bc::network;
+
+// The number of blocks the chain may trail the best known height and still
+// be synced, which absorbs announcements of blocks in flight.
+static constexpr uint64_t sync_tolerance = 6;
+
+static std::string to_string(sync_status status)
+{
+    switch (status)
+    {
+        case sync_status::initial_download:
+            return "initial download";
+        case sync_status::catching_up:
+            return "catching up";
+        case sync_status::synced:
+        default:
+            return "synced";
+    }
+}
+
+sync_state::sync_state(uint64_t last_checkpoint_height,
+    uint32_t tip_age_minutes)
+  : last_checkpoint_height_(last_checkpoint_height),
+    tip_age_seconds_(tip_age_minutes * 60),
+    top_height_(0),
+    top_timestamp_(0),
+    header_height_(0),
+    downloaded_(false),
+    status_(sync_status::initial_download)
+{
+}
+
+void sync_state::set_top(uint64_t height, uint32_t timestamp)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    top_height_ = height;
+    top_timestamp_ = timestamp;
+    update();
+}
+
+void sync_state::set_target(uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    header_height_ = std::max(header_height_, height);
+    update();
+}
+
+void sync_state::add_peer(channel::ptr node, uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_heights_[node] = height;
+    update();
+}
+
+void sync_state::remove_peer(channel::ptr node)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_heights_.erase(node);
+    update();
+}
+
+uint64_t sync_state::top_height() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return top_height_;
+}
+
+uint64_t sync_state::target_height() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return target();
+}
+
+uint64_t sync_state::target() const
+{
+    if (peer_heights_.empty())
+        return header_height_;
+
+    std::vector<uint64_t> heights;
+    heights.reserve(peer_heights_.size());
+
+    for (const auto& peer: peer_heights_)
+        heights.push_back(peer.second);
+
+    const auto middle = heights.begin() + heights.size() / 2;
+    std::nth_element(heights.begin(), middle, heights.end());
+    return std::max(header_height_, *middle);
+}
+
+void sync_state::update()
+{
+    auto status = sync_status::initial_download;
+
+    if (!downloaded_)
+    {
+        const auto now = static_cast<uint64_t>(std::time(nullptr));
+        const auto recent = uint64_t(top_timestamp_) + tip_age_seconds_ >= now;
+        downloaded_ = top_height_ >= last_checkpoint_height_ && recent;
+    }
+
+    if (downloaded_)
+        status = top_height_ + sync_tolerance < target() ?
+            sync_status::catching_up : sync_status::synced;
+
+    if (status == status_)
+        return;
+
+    log::info(LOG_SYNC)
+        << "Sync state changed from " << to_string(status_) << " to "
+        << to_string(status) << " at #" << top_height_ << " of #"
+        << target();
+
+    status_ = status;
+}
+
+sync_status sync_state::status() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+bool sync_state::synced() const
+{
+    return status() == sync_status::synced;
+}
+
+bool sync_state::initial_download() const
+{
+    return status() == sync_status::initial_download;
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/node/sync_statistics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace node {
+
+// The number of recent store latencies from which percentiles are taken.
+static constexpr size_t latency_window = 1000;
+
+sync_statistics::sync_statistics()
+  : height_(0),
+    blocks_(0),
+    transactions_(0),
+    bytes_(0),
+    orphaned_total_(0),
+    sampled_blocks_(0),
+    sampled_transactions_(0),
+    sampled_bytes_(0),
+    sampled_(clock::now()),
+    progress_{ 0, 0, 0.0, 0.0, 0.0, 0, 0, 0, 0, 0, 0 }
+{
+}
+
+void sync_statistics::downloaded(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytes_ += bytes;
+}
+
+void sync_statistics::stored(uint64_t height, size_t transactions,
+    const std::chrono::milliseconds& latency)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    height_ = std::max(height_, height);
+    transactions_ += transactions;
+    ++blocks_;
+
+    latencies_.push_back(static_cast<uint32_t>(latency.count()));
+    if (latencies_.size() > latency_window)
+        latencies_.pop_front();
+}
+
+void sync_statistics::orphaned()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++orphaned_total_;
+}
+
+sync_progress sync_statistics::sample(size_t in_flight,
+    uint64_t target_height)
+{
+    typedef std::chrono::duration<double> seconds;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = clock::now();
+    const auto elapsed = seconds(now - sampled_).count();
+
+    if (elapsed > 0)
+    {
+        progress_.blocks_per_second = (blocks_ - sampled_blocks_) / elapsed;
+        progress_.transactions_per_second =
+            (transactions_ - sampled_transactions_) / elapsed;
+        progress_.bytes_per_second = (bytes_ - sampled_bytes_) / elapsed;
+    }
+
+    sampled_ = now;
+    sampled_blocks_ = blocks_;
+    sampled_transactions_ = transactions_;
+    sampled_bytes_ = bytes_;
+
+    const auto target = std::max(target_height, height_);
+    const auto remaining = target - height_;
+    const auto rate = progress_.blocks_per_second;
+
+    progress_.height = height_;
+    progress_.target_height = target;
+    progress_.store_p50_milliseconds = percentile(50);
+    progress_.store_p90_milliseconds = percentile(90);
+    progress_.store_p99_milliseconds = percentile(99);
+    progress_.orphaned_total = orphaned_total_;
+    progress_.in_flight = in_flight;
+    progress_.eta_seconds = rate > 0 ?
+        static_cast<uint64_t>(remaining / rate) : 0;
+
+    return progress_;
+}
+
+sync_progress sync_statistics::progress() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return progress_;
+}
+
+uint32_t sync_statistics::percentile(size_t percent) const
+{
+    if (latencies_.empty())
+        return 0;
+
+    std::vector<uint32_t> sorted(latencies_.begin(), latencies_.end());
+    const auto index = (sorted.size() - 1) * percent / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+} // namespace node
+} // namespace libbitcoin
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+// A chain of unmined headers above the genesis block.
+static chain::header::list make_blocks(size_t count)
+{
+    chain::header::list blocks;
+    auto parent = mainnet_genesis_block().header;
+
+    for (size_t height = 1; height <= count; ++height)
+    {
+        auto header = parent;
+        header.previous_block_hash = parent.hash();
+        header.timestamp = parent.timestamp + 600;
+        blocks.push_back(header);
+        parent = header;
+    }
+
+    return blocks;
+}
+
+static hash_digest genesis()
+{
+    return mainnet_genesis_block().header.hash();
+}
+
+BOOST_AUTO_TEST_SUITE(announcer_tests)
+
+BOOST_AUTO_TEST_CASE(announcer__select_blocks__headers_peer__headers)
+{
+    inventory_filter known(100);
+    known.insert(genesis());
+    const auto blocks = make_blocks(2);
+
+    message::headers headers;
+    message::inventory inventory;
+    announcer::select_blocks(known, true, blocks, headers, inventory);
+    BOOST_REQUIRE_EQUAL(headers.elements.size(), 2u);
+    BOOST_REQUIRE(headers.elements.back().hash() == blocks.back().hash());
+    BOOST_REQUIRE(inventory.inventories.empty());
+}
+
+BOOST_AUTO_TEST_CASE(announcer__select_blocks__inventory_peer__inventory)
+{
+    inventory_filter known(100);
+    known.insert(genesis());
+    const auto blocks = make_blocks(2);
+
+    message::headers headers;
+    message::inventory inventory;
+    announcer::select_blocks(known, false, blocks, headers, inventory);
+    BOOST_REQUIRE(headers.elements.empty());
+    BOOST_REQUIRE_EQUAL(inventory.inventories.size(), 2u);
+    BOOST_REQUIRE(inventory.inventories.front().type ==
+        message::inventory_type_id::block);
+    BOOST_REQUIRE(inventory.inventories.front().hash ==
+        blocks.front().hash());
+}
+
+BOOST_AUTO_TEST_CASE(announcer__select_blocks__unconnected__inventory)
+{
+    // The peer is not known to have the parent of the first block.
+    inventory_filter known(100);
+    const auto blocks = make_blocks(2);
+
+    message::headers headers;
+    message::inventory inventory;
+    announcer::select_blocks(known, true, blocks, headers, inventory);
+    BOOST_REQUIRE(headers.elements.empty());
+    BOOST_REQUIRE_EQUAL(inventory.inventories.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(announcer__select_blocks__many_blocks__inventory)
+{
+    inventory_filter known(100);
+    known.insert(genesis());
+    const auto blocks = make_blocks(9);
+
+    message::headers headers;
+    message::inventory inventory;
+    announcer::select_blocks(known, true, blocks, headers, inventory);
+    BOOST_REQUIRE(headers.elements.empty());
+    BOOST_REQUIRE_EQUAL(inventory.inventories.size(), 9u);
+}
+
+BOOST_AUTO_TEST_CASE(announcer__select_blocks__announced__suppressed)
+{
+    inventory_filter known(100);
+    known.insert(genesis());
+    const auto blocks = make_blocks(2);
+
+    message::headers headers;
+    message::inventory inventory;
+    announcer::select_blocks(known, false, blocks, headers, inventory);
+    BOOST_REQUIRE_EQUAL(inventory.inventories.size(), 2u);
+
+    message::headers repeat_headers;
+    message::inventory repeat_inventory;
+    announcer::select_blocks(known, true, blocks, repeat_headers,
+        repeat_inventory);
+    BOOST_REQUIRE(repeat_headers.elements.empty());
+    BOOST_REQUIRE(repeat_inventory.inventories.empty());
+}
+
+BOOST_AUTO_TEST_CASE(announcer__select_blocks__partly_known__unknown_only)
+{
+    // The peer announced the first block, so only the second is sent, and
+    // as headers since it connects to the first.
+    inventory_filter known(100);
+    const auto blocks = make_blocks(2);
+    known.insert(blocks.front().hash());
+
+    message::headers headers;
+    message::inventory inventory;
+    announcer::select_blocks(known, true, blocks, headers, inventory);
+    BOOST_REQUIRE_EQUAL(headers.elements.size(), 1u);
+    BOOST_REQUIRE(headers.elements.front().hash() == blocks.back().hash());
+    BOOST_REQUIRE(inventory.inventories.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+// A distinct block of the size of the genesis block.
+static raw_block::ptr make_block(uint32_t id)
+{
+    auto block = mainnet_genesis_block();
+    block.header.nonce = id;
+    return std::make_shared<const raw_block>(block);
+}
+
+static size_t block_size()
+{
+    return static_cast<size_t>(mainnet_genesis_block().serialized_size());
+}
+
+BOOST_AUTO_TEST_SUITE(block_cache_tests)
+
+BOOST_AUTO_TEST_CASE(block_cache__find__empty__nullptr)
+{
+    block_cache cache(100);
+    BOOST_REQUIRE(!cache.find(null_hash));
+    BOOST_REQUIRE_EQUAL(cache.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(block_cache__store__within_budget__found)
+{
+    block_cache cache(2 * block_size());
+    const auto block = make_block(1);
+    cache.store(block);
+    BOOST_REQUIRE(cache.find(block->hash()) == block);
+    BOOST_REQUIRE_EQUAL(cache.bytes(), block_size());
+}
+
+BOOST_AUTO_TEST_CASE(block_cache__store__larger_than_budget__not_cached)
+{
+    block_cache cache(block_size() - 1);
+    cache.store(make_block(1));
+    BOOST_REQUIRE_EQUAL(cache.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(block_cache__store__over_budget__evicts_least_recent)
+{
+    block_cache cache(5 * block_size() / 2);
+    const auto first = make_block(1);
+    const auto second = make_block(2);
+    const auto third = make_block(3);
+    cache.store(first);
+    cache.store(second);
+
+    // Using the first block makes the second the least recently used.
+    BOOST_REQUIRE(cache.find(first->hash()));
+    cache.store(third);
+    BOOST_REQUIRE(cache.find(first->hash()));
+    BOOST_REQUIRE(!cache.find(second->hash()));
+    BOOST_REQUIRE(cache.find(third->hash()));
+    BOOST_REQUIRE_EQUAL(cache.bytes(), 2 * block_size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+static data_chunk decode(const std::string& encoded)
+{
+    data_chunk out;
+    BOOST_REQUIRE(decode_base16(out, encoded));
+    return out;
+}
+
+// The mainnet genesis coinbase, which pays to a public key.
+static chain::transaction coinbase()
+{
+    return mainnet_genesis_block().transactions.front();
+}
+
+// A transaction that spends the first output of the genesis coinbase, with
+// no script data.
+static chain::transaction spender()
+{
+    auto tx = coinbase();
+    tx.inputs.front().previous_output = { coinbase().hash(), 0 };
+    tx.inputs.front().script.operations.clear();
+    tx.outputs.front().script.operations.clear();
+    return tx;
+}
+
+static data_chunk public_key()
+{
+    return coinbase().outputs.front().script.operations.front().data;
+}
+
+BOOST_AUTO_TEST_SUITE(bloom_filter_tests)
+
+// Vectors from the bitcoind bloom filter tests.
+BOOST_AUTO_TEST_CASE(bloom_filter__insert__three_elements__expected_bits)
+{
+    bloom_filter filter(3, 0.01, 0, bloom_filter::update_all);
+    BOOST_REQUIRE_EQUAL(filter.hash_functions(), 5u);
+
+    const auto element = decode("99108ad8ed9bb6274d3980bab5a85c048f0950c8");
+    BOOST_REQUIRE(!filter.contains(element));
+    filter.insert(element);
+    BOOST_REQUIRE(filter.contains(element));
+
+    // One bit different in the first byte.
+    BOOST_REQUIRE(!filter.contains(
+        decode("19108ad8ed9bb6274d3980bab5a85c048f0950c8")));
+
+    filter.insert(decode("b5a2c786d9ef4658287ced5914b37a1b4aa32eee"));
+    filter.insert(decode("b9300670b4c5366e95b2699e8b18bc75e5f729c5"));
+    BOOST_REQUIRE(filter.data() == decode("614e9b"));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__insert__tweak__expected_bits)
+{
+    bloom_filter filter(3, 0.01, 2147483649u, bloom_filter::update_all);
+    filter.insert(decode("99108ad8ed9bb6274d3980bab5a85c048f0950c8"));
+    filter.insert(decode("b5a2c786d9ef4658287ced5914b37a1b4aa32eee"));
+    filter.insert(decode("b9300670b4c5366e95b2699e8b18bc75e5f729c5"));
+    BOOST_REQUIRE(filter.data() == decode("ce4299"));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__contains__full__true)
+{
+    const bloom_filter filter(data_chunk(4, 0xff), 5, 0, 0);
+    BOOST_REQUIRE(filter.contains(decode("00")));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__is_valid__oversized__false)
+{
+    const data_chunk data(bloom_filter::max_filter_bytes + 1, 0);
+    BOOST_REQUIRE(!bloom_filter(data, 5, 0, 0).is_valid());
+    BOOST_REQUIRE(!bloom_filter(data_chunk(1, 0), 51, 0, 0).is_valid());
+    BOOST_REQUIRE(bloom_filter(data_chunk(1, 0), 50, 0, 0).is_valid());
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__empty__false)
+{
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_all);
+    const auto tx = coinbase();
+    BOOST_REQUIRE(!filter.match(tx, tx.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__transaction_hash__true)
+{
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_none);
+    const auto tx = coinbase();
+    const auto hash = tx.hash();
+    filter.insert(hash);
+    BOOST_REQUIRE(filter.match(tx, hash));
+    BOOST_REQUIRE(!filter.match(spender(), spender().hash()));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__output_data__true)
+{
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_none);
+    filter.insert(public_key());
+    const auto tx = coinbase();
+    BOOST_REQUIRE(filter.match(tx, tx.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__spent_output__true)
+{
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_none);
+    const auto hash = coinbase().hash();
+
+    // The output point is the hash followed by the index (zero).
+    data_chunk point(hash.begin(), hash.end());
+    point.resize(point.size() + sizeof(uint32_t), 0);
+    filter.insert(point);
+
+    const auto tx = spender();
+    BOOST_REQUIRE(filter.match(tx, tx.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__update_all__spender_matched)
+{
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_all);
+    filter.insert(public_key());
+    const auto tx = coinbase();
+    const auto spend = spender();
+    BOOST_REQUIRE(filter.match(tx, tx.hash()));
+    BOOST_REQUIRE(filter.match(spend, spend.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__update_p2pubkey_only__spender_matched)
+{
+    // The genesis coinbase pays to a public key, so its output is inserted.
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_p2pubkey_only);
+    filter.insert(public_key());
+    const auto tx = coinbase();
+    const auto spend = spender();
+    BOOST_REQUIRE(filter.match(tx, tx.hash()));
+    BOOST_REQUIRE(filter.match(spend, spend.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__match__update_none__spender_not_matched)
+{
+    bloom_filter filter(10, 0.000001, 0, bloom_filter::update_none);
+    filter.insert(public_key());
+    const auto tx = coinbase();
+    const auto spend = spender();
+    BOOST_REQUIRE(filter.match(tx, tx.hash()));
+    BOOST_REQUIRE(!filter.match(spend, spend.hash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
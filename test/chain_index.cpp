@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::node;
+
+// Mainnet blocks #1 and #2, serialized without transaction count.
+static const std::string block1 =
+    "010000006fe28c0ab6f1b372c1a6a246ae63f74f931e8365e15a089c68d6190000000000"
+    "982051fd1e4ba744bbbe680e1fee14677ba1a3c3540bf7b1cdb606e857233e0e61bc6649"
+    "ffff001d01e36299";
+static const std::string block2 =
+    "010000004860eb18bf1b1620e37e9490fc8a427514416fd75159ab86688e9a8300000000"
+    "d5fdcc541e25de1c7a5addedf24858b8bb665c9f36ef744ee42c316022c90f9bb0bc6649"
+    "ffff001d08d2bd61";
+
+static chain::header decode_header(const std::string& encoded)
+{
+    data_chunk data;
+    BOOST_REQUIRE(decode_base16(data, encoded));
+
+    chain::header header;
+    BOOST_REQUIRE(header.from_data(data, false));
+    return header;
+}
+
+// An unmined block that links to the parent (the index does not validate).
+static block_chain::list::value_type child(const chain::header& parent,
+    uint32_t spacing)
+{
+    const auto block = std::make_shared<chain::block>();
+    block->header = parent;
+    block->header.previous_block_hash = parent.hash();
+    block->header.timestamp = parent.timestamp + spacing;
+    return block;
+}
+
+static block_chain::list::value_type to_block(const chain::header& header)
+{
+    const auto block = std::make_shared<chain::block>();
+    block->header = header;
+    return block;
+}
+
+// Initialize a mainnet chain of the genesis block at the prefix.
+static bc::blockchain::settings initchain(const char prefix[])
+{
+    boost::filesystem::remove_all(prefix);
+    boost::filesystem::create_directories(prefix);
+    database::initialize(prefix, mainnet_genesis_block());
+
+    auto settings = full_node::defaults.chain;
+    settings.database_path = prefix;
+    return settings;
+}
+
+// A started chain of the genesis block, with its index loaded.
+struct chain_fixture
+{
+    chain_fixture(const char prefix[])
+      : threads(2),
+        blockchain(threads, initchain(prefix)),
+        index(blockchain)
+    {
+        std::promise<code> started;
+        blockchain.start([&started](const code& ec)
+        {
+            started.set_value(ec);
+        });
+
+        BOOST_REQUIRE(!started.get_future().get());
+
+        std::promise<code> indexed;
+        index.start(0, [&indexed](const code& ec)
+        {
+            indexed.set_value(ec);
+        });
+
+        BOOST_REQUIRE(!indexed.get_future().get());
+    }
+
+    ~chain_fixture()
+    {
+        blockchain.stop();
+        threads.shutdown();
+        threads.join();
+    }
+
+    threadpool threads;
+    blockchain_impl blockchain;
+    chain_index index;
+};
+
+BOOST_AUTO_TEST_SUITE(chain_index_tests)
+
+BOOST_AUTO_TEST_CASE(chain_index__start__genesis__indexed)
+{
+    chain_fixture chain("chain_index__start");
+    const auto genesis = mainnet_genesis_block().header.hash();
+
+    uint64_t height;
+    BOOST_REQUIRE_EQUAL(chain.index.size(), 1u);
+    BOOST_REQUIRE(chain.index.top_hash() == genesis);
+    BOOST_REQUIRE(chain.index.find(height, genesis));
+    BOOST_REQUIRE_EQUAL(height, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__reorganize__linked__appended)
+{
+    chain_fixture chain("chain_index__reorganize_linked");
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+    chain.index.reorganize(0, { to_block(header1), to_block(header2) });
+
+    uint64_t height;
+    hash_digest hash;
+    BOOST_REQUIRE_EQUAL(chain.index.size(), 3u);
+    BOOST_REQUIRE(chain.index.top_hash() == header2.hash());
+    BOOST_REQUIRE(chain.index.find(height, header1.hash()));
+    BOOST_REQUIRE_EQUAL(height, 1u);
+    BOOST_REQUIRE(chain.index.hash_at(hash, 2));
+    BOOST_REQUIRE(hash == header2.hash());
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__reorganize__replaced__truncated)
+{
+    chain_fixture chain("chain_index__reorganize_replaced");
+    const auto genesis = mainnet_genesis_block().header;
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+    chain.index.reorganize(0, { to_block(header1), to_block(header2) });
+
+    const auto branch = child(genesis, 1);
+    chain.index.reorganize(0, { branch });
+
+    hash_digest hash;
+    BOOST_REQUIRE_EQUAL(chain.index.size(), 2u);
+    BOOST_REQUIRE(chain.index.top_hash() == branch->header.hash());
+    BOOST_REQUIRE(!chain.index.exists(header1.hash()));
+    BOOST_REQUIRE(!chain.index.exists(header2.hash()));
+    BOOST_REQUIRE(!chain.index.hash_at(hash, 2));
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__reorganize__above_index__unchanged)
+{
+    chain_fixture chain("chain_index__reorganize_above");
+    const auto header2 = decode_header(block2);
+
+    // Blocks above a loading index are read by the loader.
+    chain.index.reorganize(1, { to_block(header2) });
+    BOOST_REQUIRE_EQUAL(chain.index.size(), 1u);
+    BOOST_REQUIRE(!chain.index.exists(header2.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__fork_height__locator__highest_indexed)
+{
+    chain_fixture chain("chain_index__fork_height");
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+    chain.index.reorganize(0, { to_block(header1) });
+
+    const auto genesis = mainnet_genesis_block().header.hash();
+    BOOST_REQUIRE_EQUAL(chain.index.fork_height(
+        { header2.hash(), header1.hash(), genesis }), 1u);
+    BOOST_REQUIRE_EQUAL(chain.index.fork_height({ header2.hash() }), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__hashes__stop__excluded)
+{
+    chain_fixture chain("chain_index__hashes");
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+    chain.index.reorganize(0, { to_block(header1), to_block(header2) });
+
+    const auto hashes = chain.index.hashes(1, header2.hash(), 10);
+    BOOST_REQUIRE_EQUAL(hashes.size(), 1u);
+    BOOST_REQUIRE(hashes.front() == header1.hash());
+    BOOST_REQUIRE_EQUAL(chain.index.hashes(0, null_hash, 2).size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__headers__stop__included)
+{
+    chain_fixture chain("chain_index__headers");
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+    chain.index.reorganize(0, { to_block(header1), to_block(header2) });
+
+    const auto headers = chain.index.headers(1, header1.hash(), 10);
+    BOOST_REQUIRE_EQUAL(headers.size(), 1u);
+    BOOST_REQUIRE(headers.front().hash() == header1.hash());
+    BOOST_REQUIRE_EQUAL(chain.index.headers(0, null_hash, 10).size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(chain_index__locator__twenty_blocks__dense_then_sparse)
+{
+    chain_fixture chain("chain_index__locator");
+    auto parent = mainnet_genesis_block().header;
+    block_chain::list blocks;
+
+    for (size_t height = 1; height <= 20; ++height)
+    {
+        blocks.push_back(child(parent, 600));
+        parent = blocks.back()->header;
+    }
+
+    chain.index.reorganize(0, blocks);
+    BOOST_REQUIRE_EQUAL(chain.index.size(), 21u);
+
+    // Ten dense hashes from the top, then doubling steps down to genesis.
+    const auto locator = chain.index.locator();
+    const std::vector<uint64_t> heights
+    {
+        20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 9, 5, 0
+    };
+
+    BOOST_REQUIRE_EQUAL(locator.size(), heights.size());
+
+    for (size_t index = 0; index < heights.size(); ++index)
+    {
+        hash_digest hash;
+        BOOST_REQUIRE(chain.index.hash_at(hash, heights[index]));
+        BOOST_REQUIRE(locator[index] == hash);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+static data_chunk decode(const std::string& encoded)
+{
+    data_chunk out;
+    BOOST_REQUIRE(decode_base16(out, encoded));
+    return out;
+}
+
+// The testnet genesis block and its coinbase output script (BIP158 vector).
+static const std::string genesis_hash =
+    "000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943";
+static const std::string genesis_script =
+    "4104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6"
+    "bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac";
+
+static hash_digest genesis()
+{
+    hash_digest hash;
+    BOOST_REQUIRE(decode_hash(hash, genesis_hash));
+    return hash;
+}
+
+BOOST_AUTO_TEST_SUITE(compact_filter_tests)
+
+// Vector from the SipHash reference implementation.
+BOOST_AUTO_TEST_CASE(compact_filter__siphash__reference__expected)
+{
+    const auto key0 = 0x0706050403020100ull;
+    const auto key1 = 0x0f0e0d0c0b0a0908ull;
+    const auto data = decode("000102030405060708090a0b0c0d0e");
+    BOOST_REQUIRE_EQUAL(compact_filter::siphash(key0, key1, data),
+        0xa129ca6149be45e5ull);
+}
+
+BOOST_AUTO_TEST_CASE(compact_filter__build__testnet_genesis__expected)
+{
+    const auto script = decode(genesis_script);
+    const auto filter = compact_filter::build(genesis(), { script, script });
+    BOOST_REQUIRE_EQUAL(encode_base16(filter), "019dfca8");
+}
+
+BOOST_AUTO_TEST_CASE(compact_filter__header__testnet_genesis__expected)
+{
+    const auto filter = decode("019dfca8");
+    BOOST_REQUIRE_EQUAL(encode_hash(compact_filter::header(filter, null_hash)),
+        "21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750");
+}
+
+BOOST_AUTO_TEST_CASE(compact_filter__match__testnet_genesis__expected)
+{
+    const auto filter = decode("019dfca8");
+    BOOST_REQUIRE(compact_filter::match(filter, genesis(),
+        decode(genesis_script)));
+    BOOST_REQUIRE(!compact_filter::match(filter, genesis(), decode("00")));
+}
+
+BOOST_AUTO_TEST_CASE(compact_filter__build__empty__zero_count)
+{
+    const auto filter = compact_filter::build(genesis(), {});
+    BOOST_REQUIRE_EQUAL(encode_base16(filter), "00");
+    BOOST_REQUIRE(!compact_filter::match(filter, genesis(), decode("00")));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
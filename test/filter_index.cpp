@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::node;
+
+// A record is the block hash, the filter header, the size and the filter.
+static constexpr size_t record_prefix = 2 * hash_size + sizeof(uint32_t);
+
+// Initialize a mainnet chain of the genesis block at the prefix.
+static bc::blockchain::settings initchain(const char prefix[])
+{
+    boost::filesystem::remove_all(prefix);
+    boost::filesystem::create_directories(prefix);
+    database::initialize(prefix, mainnet_genesis_block());
+
+    auto settings = full_node::defaults.chain;
+    settings.database_path = prefix;
+    return settings;
+}
+
+// A started chain of the genesis block, with its index loaded.
+struct chain_fixture
+{
+    chain_fixture(const char prefix[])
+      : threads(2),
+        blockchain(threads, initchain(prefix)),
+        index(blockchain),
+        file(boost::filesystem::path(prefix) / "compact_filters")
+    {
+        std::promise<code> started;
+        blockchain.start([&started](const code& ec)
+        {
+            started.set_value(ec);
+        });
+
+        BOOST_REQUIRE(!started.get_future().get());
+
+        std::promise<code> indexed;
+        index.start(0, [&indexed](const code& ec)
+        {
+            indexed.set_value(ec);
+        });
+
+        BOOST_REQUIRE(!indexed.get_future().get());
+    }
+
+    ~chain_fixture()
+    {
+        blockchain.stop();
+        threads.shutdown();
+        threads.join();
+    }
+
+    threadpool threads;
+    blockchain_impl blockchain;
+    chain_index index;
+    const boost::filesystem::path file;
+};
+
+// Filters are built in the background.
+static bool wait_for(const filter_index& filters, uint64_t size)
+{
+    for (size_t attempt = 0; attempt < 1000; ++attempt)
+    {
+        if (filters.size() == size)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+static data_chunk read_file(const boost::filesystem::path& file)
+{
+    std::ifstream stream(file.string(), std::ios::binary);
+    return data_chunk(std::istreambuf_iterator<char>(stream),
+        std::istreambuf_iterator<char>());
+}
+
+static void append_file(const boost::filesystem::path& file,
+    const data_chunk& data)
+{
+    std::ofstream stream(file.string(), std::ios::binary | std::ios::app);
+    stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+BOOST_AUTO_TEST_SUITE(filter_index_tests)
+
+BOOST_AUTO_TEST_CASE(filter_index__start__genesis__writes_record)
+{
+    // WARNING: file system side effect, use unique relative path.
+    chain_fixture chain("filter_index_test/writes_record");
+    filter_index filters(chain.threads, chain.blockchain, chain.index,
+        chain.file);
+    BOOST_REQUIRE(filters.start(0));
+    BOOST_REQUIRE(wait_for(filters, 1));
+
+    data_chunk filter;
+    hash_digest header;
+    BOOST_REQUIRE(filters.filter(filter, 0));
+    BOOST_REQUIRE(filters.filter_header(header, 0));
+    BOOST_REQUIRE(!filters.filter(filter, 1));
+    BOOST_REQUIRE(header == compact_filter::header(filter, null_hash));
+    filters.stop();
+
+    const auto genesis = mainnet_genesis_block().header.hash();
+    const auto record = read_file(chain.file);
+    BOOST_REQUIRE_EQUAL(record.size(), record_prefix + filter.size());
+    BOOST_REQUIRE(std::equal(genesis.begin(), genesis.end(),
+        record.begin()));
+    BOOST_REQUIRE(std::equal(header.begin(), header.end(),
+        record.begin() + hash_size));
+    BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint32_t>(
+        record.begin() + 2 * hash_size), uint32_t(filter.size()));
+    BOOST_REQUIRE(std::equal(filter.begin(), filter.end(),
+        record.begin() + record_prefix));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__start__restart__reloads)
+{
+    // WARNING: file system side effect, use unique relative path.
+    chain_fixture chain("filter_index_test/reloads");
+    hash_digest header;
+
+    {
+        filter_index filters(chain.threads, chain.blockchain, chain.index,
+            chain.file);
+        BOOST_REQUIRE(filters.start(0));
+        BOOST_REQUIRE(wait_for(filters, 1));
+        BOOST_REQUIRE(filters.filter_header(header, 0));
+        filters.stop();
+    }
+
+    // The index is loaded from the file, without building.
+    filter_index filters(chain.threads, chain.blockchain, chain.index,
+        chain.file);
+    BOOST_REQUIRE(filters.start(0));
+    BOOST_REQUIRE_EQUAL(filters.size(), 1u);
+
+    hash_digest reloaded;
+    BOOST_REQUIRE(filters.filter_header(reloaded, 0));
+    BOOST_REQUIRE(reloaded == header);
+    filters.stop();
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__start__reorganized_record__truncated)
+{
+    // WARNING: file system side effect, use unique relative path.
+    chain_fixture chain("filter_index_test/reorganized_record");
+
+    {
+        filter_index filters(chain.threads, chain.blockchain, chain.index,
+            chain.file);
+        BOOST_REQUIRE(filters.start(0));
+        BOOST_REQUIRE(wait_for(filters, 1));
+        filters.stop();
+    }
+
+    const auto size = boost::filesystem::file_size(chain.file);
+
+    // A record of a block that is not in the chain, as if it had been
+    // reorganized out while stopped.
+    data_chunk stale(record_prefix + 1, 0x42);
+    stale[2 * hash_size + 0] = 1;
+    stale[2 * hash_size + 1] = 0;
+    stale[2 * hash_size + 2] = 0;
+    stale[2 * hash_size + 3] = 0;
+    append_file(chain.file, stale);
+
+    filter_index filters(chain.threads, chain.blockchain, chain.index,
+        chain.file);
+    BOOST_REQUIRE(filters.start(0));
+    BOOST_REQUIRE_EQUAL(filters.size(), 1u);
+    filters.stop();
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size(chain.file), size);
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__start__partial_record__truncated)
+{
+    // WARNING: file system side effect, use unique relative path.
+    chain_fixture chain("filter_index_test/partial_record");
+
+    {
+        filter_index filters(chain.threads, chain.blockchain, chain.index,
+            chain.file);
+        BOOST_REQUIRE(filters.start(0));
+        BOOST_REQUIRE(wait_for(filters, 1));
+        filters.stop();
+    }
+
+    const auto size = boost::filesystem::file_size(chain.file);
+
+    // A record cut short by a crash while writing.
+    append_file(chain.file, data_chunk(record_prefix - 1, 0x42));
+
+    filter_index filters(chain.threads, chain.blockchain, chain.index,
+        chain.file);
+    BOOST_REQUIRE(filters.start(0));
+    BOOST_REQUIRE_EQUAL(filters.size(), 1u);
+    filters.stop();
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size(chain.file), size);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
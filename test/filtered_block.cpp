@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+// Merkle blocks (BIP37) of the genesis header, for one matched transaction
+// and for none, and for three transactions with the second matched (the
+// partial tree is the first hash, the second hash and the hash of the third
+// paired with itself, with flag bits 1, 1, 0, 1, 0).
+static const std::string genesis_matched =
+    "0100000000000000000000000000000000000000000000000000000000000000000000"
+    "003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab"
+    "5f49ffff001d1dac2b7c01000000013ba3edfd7a7b12b27ac72c3e67768f617fc81bc3"
+    "888a51323a9fb8aa4b1e5e4a0101";
+static const std::string genesis_unmatched =
+    "0100000000000000000000000000000000000000000000000000000000000000000000"
+    "003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab"
+    "5f49ffff001d1dac2b7c01000000013ba3edfd7a7b12b27ac72c3e67768f617fc81bc3"
+    "888a51323a9fb8aa4b1e5e4a0100";
+static const std::string three_second_matched =
+    "0100000000000000000000000000000000000000000000000000000000000000000000"
+    "003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab"
+    "5f49ffff001d1dac2b7c03000000033ba3edfd7a7b12b27ac72c3e67768f617fc81bc3"
+    "888a51323a9fb8aa4b1e5e4aa5cff75e8e4da25d7a7cf044e54107b7a15eb92abc2ae4"
+    "9af9a0284b5c15ad4a8f8abaa9f57061735accebe57c1543fbbc5512745cabe44ad601"
+    "8429122ca190010b";
+
+static data_chunk decode(const std::string& encoded)
+{
+    data_chunk out;
+    BOOST_REQUIRE(decode_base16(out, encoded));
+    return out;
+}
+
+// The genesis coinbase, spending the null hash at the index instead.
+static chain::transaction spend(uint32_t index)
+{
+    auto tx = mainnet_genesis_block().transactions.front();
+    tx.inputs.front().previous_output.index = index;
+    return tx;
+}
+
+BOOST_AUTO_TEST_SUITE(filtered_block_tests)
+
+BOOST_AUTO_TEST_CASE(filtered_block__to_data__genesis_matched__expected)
+{
+    const auto block = mainnet_genesis_block();
+    bloom_filter filter(1, 0.000001, 0, bloom_filter::update_none);
+    filter.insert(block.transactions.front().hash());
+
+    const filtered_block merkle(block, filter);
+    BOOST_REQUIRE_EQUAL(merkle.matches().size(), 1u);
+    BOOST_REQUIRE_EQUAL(merkle.matches().front(), 0u);
+    BOOST_REQUIRE(merkle.to_data() == decode(genesis_matched));
+    BOOST_REQUIRE_EQUAL(merkle.satoshi_size(), merkle.to_data().size());
+}
+
+BOOST_AUTO_TEST_CASE(filtered_block__to_data__genesis_unmatched__expected)
+{
+    const auto block = mainnet_genesis_block();
+    bloom_filter filter(1, 0.000001, 0, bloom_filter::update_none);
+    filter.insert(null_hash);
+
+    const filtered_block merkle(block, filter);
+    BOOST_REQUIRE(merkle.matches().empty());
+    BOOST_REQUIRE(merkle.to_data() == decode(genesis_unmatched));
+}
+
+BOOST_AUTO_TEST_CASE(filtered_block__to_data__three_second_matched__expected)
+{
+    auto block = mainnet_genesis_block();
+    block.transactions.push_back(spend(0));
+    block.transactions.push_back(spend(1));
+
+    bloom_filter filter(1, 0.000001, 0, bloom_filter::update_none);
+    filter.insert(block.transactions[1].hash());
+
+    const filtered_block merkle(block, filter);
+    BOOST_REQUIRE_EQUAL(merkle.matches().size(), 1u);
+    BOOST_REQUIRE_EQUAL(merkle.matches().front(), 1u);
+    BOOST_REQUIRE_EQUAL(merkle.hashes().size(), 3u);
+    BOOST_REQUIRE(merkle.to_data() == decode(three_second_matched));
+    BOOST_REQUIRE_EQUAL(merkle.satoshi_size(), merkle.to_data().size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,344 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+// Mainnet blocks #1 and #2, serialized without transaction count.
+static const std::string block1 =
+    "010000006fe28c0ab6f1b372c1a6a246ae63f74f931e8365e15a089c68d6190000000000"
+    "982051fd1e4ba744bbbe680e1fee14677ba1a3c3540bf7b1cdb606e857233e0e61bc6649"
+    "ffff001d01e36299";
+static const std::string block2 =
+    "010000004860eb18bf1b1620e37e9490fc8a427514416fd75159ab86688e9a8300000000"
+    "d5fdcc541e25de1c7a5addedf24858b8bb665c9f36ef744ee42c316022c90f9bb0bc6649"
+    "ffff001d08d2bd61";
+
+static const uint32_t limit_bits = 0x1d00ffff;
+
+static chain::header decode_header(const std::string& encoded)
+{
+    data_chunk data;
+    BOOST_REQUIRE(decode_base16(data, encoded));
+
+    chain::header header;
+    BOOST_REQUIRE(header.from_data(data, false));
+    return header;
+}
+
+// An unmined header that links to the parent.
+static chain::header child(const chain::header& parent, uint32_t spacing,
+    uint32_t bits)
+{
+    auto header = parent;
+    header.previous_block_hash = parent.hash();
+    header.timestamp = parent.timestamp + spacing;
+    header.bits = bits;
+    return header;
+}
+
+// The queue seeded with the mainnet genesis block as the chain top.
+static void seed(header_queue& queue)
+{
+    queue.initialize({ mainnet_genesis_block().header }, 0);
+}
+
+BOOST_AUTO_TEST_SUITE(header_queue_tests)
+
+BOOST_AUTO_TEST_CASE(header_queue__initialize__chain_top__empty)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto genesis = mainnet_genesis_block().header.hash();
+
+    uint64_t height;
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+    BOOST_REQUIRE_EQUAL(queue.first_height(), 0u);
+    BOOST_REQUIRE_EQUAL(queue.last_height(), 0u);
+    BOOST_REQUIRE(queue.last_hash() == genesis);
+    BOOST_REQUIRE(!queue.find(height, genesis));
+    BOOST_REQUIRE(queue.reserve(10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__linked__success)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header2 = decode_header(block2);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ decode_header(block1), header2 },
+        fork, replaced).value(), error::success);
+    BOOST_REQUIRE_EQUAL(fork, 0u);
+    BOOST_REQUIRE(replaced.empty());
+
+    uint64_t height;
+    BOOST_REQUIRE_EQUAL(queue.size(), 2u);
+    BOOST_REQUIRE_EQUAL(queue.last_height(), 2u);
+    BOOST_REQUIRE(queue.last_hash() == header2.hash());
+    BOOST_REQUIRE(queue.find(height, header2.hash()));
+    BOOST_REQUIRE_EQUAL(height, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__known__skipped)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const chain::header::list headers
+    {
+        decode_header(block1), decode_header(block2)
+    };
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE(!queue.enqueue(headers, fork, replaced));
+    BOOST_REQUIRE(!queue.enqueue(headers, fork, replaced));
+    BOOST_REQUIRE_EQUAL(fork, 2u);
+    BOOST_REQUIRE(replaced.empty());
+    BOOST_REQUIRE_EQUAL(queue.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__unlinked__bad_stream)
+{
+    header_queue queue({}, false);
+    seed(queue);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ decode_header(block2) }, fork,
+        replaced).value(), error::bad_stream);
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__wrong_bits__incorrect_proof_of_work)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    auto header = decode_header(block1);
+    header.bits = 0x1c00ffff;
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ header }, fork, replaced).value(),
+        error::incorrect_proof_of_work);
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__invalid_proof_of_work__proof_of_work)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    auto header = decode_header(block1);
+    header.nonce += 1;
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ header }, fork, replaced).value(),
+        error::proof_of_work);
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__checkpoint_conflict__checkpoints_failed)
+{
+    const config::checkpoint checkpoint(
+        "000000006a625f06636b8bb6ac7b960a8d03705d1ace08b1a19da3fdcc99ddbd", 1);
+    header_queue queue({ checkpoint }, false);
+    seed(queue);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ decode_header(block1) }, fork,
+        replaced).value(), error::checkpoints_failed);
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__fast_retarget_period__incorrect_proof_of_work)
+{
+    header_queue queue({}, false);
+    const auto start = decode_header(block1);
+    const auto parent = child(start, 600, limit_bits);
+    queue.initialize({ start, parent }, 2014);
+
+    // A period mined in under a quarter of the target timespan retargets to a
+    // quarter of the limit.
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ child(parent, 600, limit_bits) },
+        fork, replaced).value(), error::incorrect_proof_of_work);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__slow_retarget_period__limit_required)
+{
+    header_queue queue({}, false);
+    const auto start = decode_header(block1);
+    const auto parent = child(start, 30 * 24 * 60 * 60, limit_bits);
+    queue.initialize({ start, parent }, 2014);
+
+    // The retarget is capped at the limit, so only the proof fails.
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ child(parent, 600, limit_bits) },
+        fork, replaced).value(), error::proof_of_work);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__enqueue__testnet_minimum_difficulty__limit_allowed)
+{
+    header_queue queue({}, true);
+    const auto start = child(decode_header(block1), 600, 0x1c00ffff);
+    queue.initialize({ start }, 5);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ child(start, 1201, limit_bits) },
+        fork, replaced).value(), error::proof_of_work);
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ child(start, 600, limit_bits) },
+        fork, replaced).value(), error::incorrect_proof_of_work);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__reserve__released__reserved_again)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header1 = decode_header(block1);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE(!queue.enqueue({ header1 }, fork, replaced));
+
+    const auto reserved = queue.reserve(10);
+    BOOST_REQUIRE_EQUAL(reserved.size(), 1u);
+    BOOST_REQUIRE(reserved.front() == header1.hash());
+    BOOST_REQUIRE(queue.reserve(10).empty());
+
+    queue.release(reserved);
+    BOOST_REQUIRE_EQUAL(queue.reserve(10).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__reserve__completed__not_reserved_again)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE(!queue.enqueue({ header1, header2 }, fork, replaced));
+
+    // A block received after its request was released is not reserved.
+    const auto reserved = queue.reserve(1);
+    BOOST_REQUIRE_EQUAL(reserved.size(), 1u);
+    queue.release(reserved);
+    queue.complete(header1.hash());
+
+    // A block received before it was reserved is skipped.
+    queue.complete(header2.hash());
+    BOOST_REQUIRE(queue.reserve(10).empty());
+
+    queue.release(reserved);
+    BOOST_REQUIRE(queue.reserve(10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__confirm__queued__top_advanced)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE(!queue.enqueue({ header1, header2 }, fork, replaced));
+    BOOST_REQUIRE(queue.confirm(header1, 1));
+
+    uint64_t height;
+    BOOST_REQUIRE_EQUAL(queue.size(), 1u);
+    BOOST_REQUIRE(!queue.find(height, header1.hash()));
+    BOOST_REQUIRE(queue.find(height, header2.hash()));
+
+    const auto reserved = queue.reserve(10);
+    BOOST_REQUIRE_EQUAL(reserved.size(), 1u);
+    BOOST_REQUIRE(reserved.front() == header2.hash());
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__confirm__extension__appended)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header1 = decode_header(block1);
+
+    BOOST_REQUIRE(queue.confirm(header1, 1));
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+    BOOST_REQUIRE_EQUAL(queue.last_height(), 1u);
+    BOOST_REQUIRE(queue.last_hash() == header1.hash());
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__confirm__diverged__false)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    BOOST_REQUIRE(!queue.confirm(decode_header(block2), 1));
+    BOOST_REQUIRE_EQUAL(queue.last_height(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__locator__queued__top_first)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE(!queue.enqueue({ header1, header2 }, fork, replaced));
+
+    const auto locator = queue.locator();
+    BOOST_REQUIRE_EQUAL(locator.size(), 3u);
+    BOOST_REQUIRE(locator[0] == header2.hash());
+    BOOST_REQUIRE(locator[1] == header1.hash());
+    BOOST_REQUIRE(locator[2] == mainnet_genesis_block().header.hash());
+}
+
+BOOST_AUTO_TEST_CASE(header_queue__ban__queued__removed_and_rejected)
+{
+    header_queue queue({}, false);
+    seed(queue);
+    const auto header1 = decode_header(block1);
+    const auto header2 = decode_header(block2);
+
+    uint64_t fork;
+    hash_list replaced;
+    BOOST_REQUIRE(!queue.enqueue({ header1, header2 }, fork, replaced));
+    BOOST_REQUIRE_EQUAL(queue.reserve(10).size(), 2u);
+
+    const auto removed = queue.ban(header1.hash());
+    BOOST_REQUIRE_EQUAL(removed.size(), 2u);
+    BOOST_REQUIRE(removed.front() == header1.hash());
+    BOOST_REQUIRE(queue.banned(header1.hash()));
+    BOOST_REQUIRE(queue.banned(header2.hash()));
+    BOOST_REQUIRE_EQUAL(queue.size(), 0u);
+    BOOST_REQUIRE_EQUAL(queue.enqueue({ header1 }, fork, replaced).value(),
+        error::operation_failed);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+BOOST_AUTO_TEST_SUITE(inventory_filter_tests)
+
+static hash_digest make_hash(uint32_t value)
+{
+    return sha256_hash(to_little_endian(value));
+}
+
+BOOST_AUTO_TEST_CASE(inventory_filter__contains__empty__false)
+{
+    inventory_filter filter(100);
+    BOOST_REQUIRE(!filter.contains(make_hash(42)));
+}
+
+BOOST_AUTO_TEST_CASE(inventory_filter__contains__inserted__true)
+{
+    inventory_filter filter(100);
+    filter.insert(make_hash(42));
+    BOOST_REQUIRE(filter.contains(make_hash(42)));
+}
+
+BOOST_AUTO_TEST_CASE(inventory_filter__contains__cleared__false)
+{
+    inventory_filter filter(100);
+    filter.insert(make_hash(42));
+    filter.clear();
+    BOOST_REQUIRE(!filter.contains(make_hash(42)));
+}
+
+BOOST_AUTO_TEST_CASE(inventory_filter__contains__last_capacity_inserted__true)
+{
+    inventory_filter filter(100);
+
+    for (uint32_t value = 0; value < 1000; ++value)
+        filter.insert(make_hash(value));
+
+    for (uint32_t value = 900; value < 1000; ++value)
+        BOOST_REQUIRE(filter.contains(make_hash(value)));
+}
+
+BOOST_AUTO_TEST_CASE(inventory_filter__contains__two_generations_old__false)
+{
+    inventory_filter filter(100);
+    filter.insert(make_hash(42));
+
+    for (uint32_t value = 1000; value < 1200; ++value)
+        filter.insert(make_hash(value));
+
+    // The probability of a false positive here is negligible.
+    BOOST_REQUIRE(!filter.contains(make_hash(42)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
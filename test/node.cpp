@@ -78,7 +78,9 @@ BOOST_AUTO_TEST_CASE(node_test__construct_getx_responder__does_not_throw)
     configuration config;
     blockchain_impl blockchain(threads, config.chain);
     transaction_pool transactions(threads, blockchain, 42);
-    responder responder(blockchain, transactions);
+    chain_index index(blockchain);
+    sync_state sync(0, NODE_SYNC_TIP_AGE_MINUTES);
+    responder responder(blockchain, index, sync, transactions, 0);
 
     // TODO: handle blockchain start.
     blockchain.start([](code){});
@@ -99,7 +101,9 @@ BOOST_AUTO_TEST_CASE(node_test__construct_poller__does_not_throw)
     threadpool threads;
     configuration config;
     blockchain_impl blockchain(threads, config.chain);
-    poller poller(threads, blockchain);
+    chain_index index(blockchain);
+    sync_state sync(0, NODE_SYNC_TIP_AGE_MINUTES);
+    poller poller(threads, blockchain, index, sync, config);
 
     // TODO: handle blockchain start.
     blockchain.start([](code){});
@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::network;
+using namespace bc::node;
+
+// Distinct channel keys. The scores do not dereference their channels.
+static uint8_t channels[3];
+
+static channel::ptr key(size_t index)
+{
+    return channel::ptr(channel::ptr(),
+        reinterpret_cast<channel*>(&channels[index]));
+}
+
+// Measure a single block of the given size received from the channel.
+static void measure(peer_scores& scores, channel::ptr node, uint64_t bytes)
+{
+    scores.add(node);
+    scores.requested(node, 1);
+    scores.received(node, bytes);
+}
+
+BOOST_AUTO_TEST_SUITE(peer_scores_tests)
+
+BOOST_AUTO_TEST_CASE(peer_scores__share__unmeasured__count)
+{
+    peer_scores scores(60);
+    scores.add(key(0));
+    BOOST_REQUIRE_EQUAL(scores.share(key(0), 100), 100u);
+    BOOST_REQUIRE_EQUAL(scores.share(key(1), 100), 100u);
+    BOOST_REQUIRE_EQUAL(scores.rate(key(0)), 0u);
+    BOOST_REQUIRE(scores.latency(key(0)) == std::chrono::milliseconds::zero());
+}
+
+BOOST_AUTO_TEST_CASE(peer_scores__share__single_channel__count)
+{
+    peer_scores scores(60);
+    measure(scores, key(0), 1000000);
+    BOOST_REQUIRE_EQUAL(scores.share(key(0), 100), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(peer_scores__share__relative_rates__bounded)
+{
+    peer_scores scores(60);
+    measure(scores, key(0), 1000000000);
+    measure(scores, key(1), 1);
+    measure(scores, key(2), 1);
+    BOOST_REQUIRE_EQUAL(scores.share(key(0), 100), 200u);
+    BOOST_REQUIRE_EQUAL(scores.share(key(1), 100), 25u);
+    BOOST_REQUIRE_EQUAL(scores.share(key(1), 2), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(peer_scores__rate__received__measured)
+{
+    peer_scores scores(60);
+    measure(scores, key(0), 1000000);
+    BOOST_REQUIRE_GT(scores.rate(key(0)), 0u);
+    BOOST_REQUIRE_EQUAL(scores.rate(key(1)), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(peer_scores__stalled__measured__rate_halved)
+{
+    peer_scores scores(60);
+    measure(scores, key(0), 1000000);
+    const auto rate = scores.rate(key(0));
+    BOOST_REQUIRE_EQUAL(scores.stalled(key(0)), 1u);
+    BOOST_REQUIRE_LE(scores.rate(key(0)), rate / 2 + 1);
+
+    // Stalls within the stall period are counted once.
+    BOOST_REQUIRE_EQUAL(scores.stalled(key(0)), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(peer_scores__received__removed__ignored)
+{
+    peer_scores scores(60);
+    measure(scores, key(0), 1000000);
+    scores.remove(key(0));
+    scores.requested(key(0), 1);
+    scores.received(key(0), 1000000);
+    BOOST_REQUIRE_EQUAL(scores.stalled(key(0)), 0u);
+    BOOST_REQUIRE_EQUAL(scores.rate(key(0)), 0u);
+    BOOST_REQUIRE_EQUAL(scores.share(key(0), 100), 100u);
+    BOOST_REQUIRE(scores.scores().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+// A transaction of the genesis coinbase that spends a previous output.
+static chain::transaction spend()
+{
+    auto tx = mainnet_genesis_block().transactions.front();
+    tx.inputs.front().previous_output.index = 0;
+    return tx;
+}
+
+BOOST_AUTO_TEST_SUITE(prevalidate_tests)
+
+BOOST_AUTO_TEST_CASE(prevalidate__genesis__success)
+{
+    BOOST_REQUIRE_EQUAL(prevalidate(mainnet_genesis_block()).value(),
+        error::success);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__empty__size_limits)
+{
+    auto block = mainnet_genesis_block();
+    block.transactions.clear();
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(), error::size_limits);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__oversize__size_limits)
+{
+    auto block = mainnet_genesis_block();
+    const auto tx = spend();
+    const auto count = 1000000 / tx.serialized_size() + 1;
+
+    for (size_t index = 0; index < count; ++index)
+        block.transactions.push_back(tx);
+
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(), error::size_limits);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__missing_coinbase__first_not_coinbase)
+{
+    auto block = mainnet_genesis_block();
+    block.transactions.front() = spend();
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(),
+        error::first_not_coinbase);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__extra_coinbase__extra_coinbases)
+{
+    auto block = mainnet_genesis_block();
+    block.transactions.push_back(block.transactions.front());
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(), error::extra_coinbases);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__duplicate_transaction__duplicate)
+{
+    auto block = mainnet_genesis_block();
+    block.transactions.push_back(spend());
+    block.transactions.push_back(spend());
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(), error::duplicate);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__bad_merkle_root__merkle_mismatch)
+{
+    // Changing the transactions preserves the header proof of work.
+    auto block = mainnet_genesis_block();
+    block.transactions.front().locktime = 1;
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(), error::merkle_mismatch);
+}
+
+BOOST_AUTO_TEST_CASE(prevalidate__added_transaction__merkle_mismatch)
+{
+    auto block = mainnet_genesis_block();
+    block.transactions.push_back(spend());
+    BOOST_REQUIRE_EQUAL(prevalidate(block).value(), error::merkle_mismatch);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
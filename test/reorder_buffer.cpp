@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::network;
+using namespace bc::node;
+
+BOOST_AUTO_TEST_SUITE(reorder_buffer_tests)
+
+BOOST_AUTO_TEST_CASE(reorder_buffer__pop__gap__false)
+{
+    reorder_buffer buffer(1000000);
+    buffer.initialize(10);
+    BOOST_REQUIRE(buffer.push(11, mainnet_genesis_block(), nullptr));
+
+    chain::block out_block;
+    channel::ptr out_node;
+    BOOST_REQUIRE(!buffer.pop(out_block, out_node));
+    BOOST_REQUIRE_EQUAL(buffer.size(), 1u);
+    BOOST_REQUIRE_EQUAL(buffer.next_height(), 10u);
+    BOOST_REQUIRE_EQUAL(buffer.top_height(), 11u);
+}
+
+BOOST_AUTO_TEST_CASE(reorder_buffer__pop__contiguous__height_order)
+{
+    reorder_buffer buffer(1000000);
+    buffer.initialize(10);
+    BOOST_REQUIRE(buffer.push(11, mainnet_genesis_block(), nullptr));
+    BOOST_REQUIRE(buffer.push(10, mainnet_genesis_block(), nullptr));
+
+    chain::block out_block;
+    channel::ptr out_node;
+    BOOST_REQUIRE(buffer.pop(out_block, out_node));
+    BOOST_REQUIRE_EQUAL(buffer.next_height(), 11u);
+    BOOST_REQUIRE(buffer.pop(out_block, out_node));
+    BOOST_REQUIRE_EQUAL(buffer.next_height(), 12u);
+    BOOST_REQUIRE(!buffer.pop(out_block, out_node));
+    BOOST_REQUIRE_EQUAL(buffer.bytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(reorder_buffer__push__redundant__false)
+{
+    reorder_buffer buffer(1000000);
+    buffer.initialize(10);
+    BOOST_REQUIRE(!buffer.push(9, mainnet_genesis_block(), nullptr));
+    BOOST_REQUIRE(buffer.push(12, mainnet_genesis_block(), nullptr));
+    BOOST_REQUIRE(!buffer.push(12, mainnet_genesis_block(), nullptr));
+    BOOST_REQUIRE_EQUAL(buffer.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(reorder_buffer__full__capacity_reached__true)
+{
+    const auto genesis = mainnet_genesis_block();
+    const auto size = static_cast<size_t>(genesis.serialized_size());
+    reorder_buffer buffer(2 * size);
+    buffer.initialize(10);
+    BOOST_REQUIRE(buffer.push(12, genesis, nullptr));
+    BOOST_REQUIRE(!buffer.full());
+    BOOST_REQUIRE(buffer.push(13, genesis, nullptr));
+    BOOST_REQUIRE(buffer.full());
+    BOOST_REQUIRE_EQUAL(buffer.bytes(), 2 * size);
+}
+
+BOOST_AUTO_TEST_CASE(reorder_buffer__truncate__replaced__discarded)
+{
+    const auto genesis = mainnet_genesis_block();
+    const auto size = static_cast<size_t>(genesis.serialized_size());
+    reorder_buffer buffer(1000000);
+    buffer.initialize(10);
+    BOOST_REQUIRE(buffer.push(10, genesis, nullptr));
+    BOOST_REQUIRE(buffer.push(12, genesis, nullptr));
+    BOOST_REQUIRE(buffer.push(13, genesis, nullptr));
+
+    chain::block out_block;
+    channel::ptr out_node;
+    BOOST_REQUIRE(buffer.pop(out_block, out_node));
+
+    buffer.truncate(12);
+    BOOST_REQUIRE_EQUAL(buffer.size(), 1u);
+    BOOST_REQUIRE_EQUAL(buffer.bytes(), size);
+    BOOST_REQUIRE_EQUAL(buffer.next_height(), 11u);
+
+    buffer.truncate(8);
+    BOOST_REQUIRE_EQUAL(buffer.size(), 0u);
+    BOOST_REQUIRE_EQUAL(buffer.bytes(), 0u);
+    BOOST_REQUIRE_EQUAL(buffer.next_height(), 9u);
+    BOOST_REQUIRE(buffer.push(9, genesis, nullptr));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
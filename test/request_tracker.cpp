@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::network;
+using namespace bc::node;
+
+// Distinct channel keys. The tracker does not dereference its channels.
+static uint8_t channels[2];
+
+static channel::ptr key(size_t index)
+{
+    return channel::ptr(channel::ptr(),
+        reinterpret_cast<channel*>(&channels[index]));
+}
+
+static const hash_digest hash1{ { 1 } };
+static const hash_digest hash2{ { 2 } };
+static const hash_digest hash3{ { 3 } };
+
+BOOST_AUTO_TEST_SUITE(request_tracker_tests)
+
+BOOST_AUTO_TEST_CASE(request_tracker__request__in_flight__false)
+{
+    threadpool threads(1);
+    request_tracker tracker(threads, 60);
+    BOOST_REQUIRE(tracker.request(hash1, key(0)));
+    BOOST_REQUIRE(!tracker.request(hash1, key(1)));
+    BOOST_REQUIRE(tracker.requested(hash1));
+    BOOST_REQUIRE(!tracker.requested(hash2));
+    BOOST_REQUIRE_EQUAL(tracker.size(), 1u);
+    threads.shutdown();
+    threads.join();
+}
+
+BOOST_AUTO_TEST_CASE(request_tracker__complete__requested__fallback_allowed)
+{
+    threadpool threads(1);
+    request_tracker tracker(threads, 60);
+    BOOST_REQUIRE(tracker.request(hash1, key(0)));
+    BOOST_REQUIRE(tracker.complete(hash1));
+    BOOST_REQUIRE(!tracker.complete(hash1));
+    BOOST_REQUIRE(!tracker.requested(hash1));
+
+    // Once answered the hash may be requested of another channel.
+    BOOST_REQUIRE(tracker.request(hash1, key(1)));
+    threads.shutdown();
+    threads.join();
+}
+
+BOOST_AUTO_TEST_CASE(request_tracker__complete_channel__other_channel__false)
+{
+    threadpool threads(1);
+    request_tracker tracker(threads, 60);
+    BOOST_REQUIRE(tracker.request(hash1, key(0)));
+
+    // A not found reply from a channel that was not asked is ignored.
+    BOOST_REQUIRE(!tracker.complete(hash1, key(1)));
+    BOOST_REQUIRE(tracker.requested(hash1));
+    BOOST_REQUIRE(!tracker.complete(hash2, key(0)));
+
+    // A not found reply from the channel asked releases the request.
+    BOOST_REQUIRE(tracker.complete(hash1, key(0)));
+    BOOST_REQUIRE(!tracker.requested(hash1));
+    BOOST_REQUIRE(tracker.request(hash1, key(1)));
+    threads.shutdown();
+    threads.join();
+}
+
+BOOST_AUTO_TEST_CASE(request_tracker__release__channel__its_requests)
+{
+    threadpool threads(1);
+    request_tracker tracker(threads, 60);
+    BOOST_REQUIRE(tracker.request(hash1, key(0)));
+    BOOST_REQUIRE(tracker.request(hash2, key(1)));
+    BOOST_REQUIRE(tracker.request(hash3, key(0)));
+
+    const auto released = tracker.release(key(0));
+    BOOST_REQUIRE_EQUAL(released.size(), 2u);
+    BOOST_REQUIRE_EQUAL(tracker.size(), 1u);
+    BOOST_REQUIRE(tracker.requested(hash2));
+    BOOST_REQUIRE(tracker.release(key(0)).empty());
+    threads.shutdown();
+    threads.join();
+}
+
+BOOST_AUTO_TEST_CASE(request_tracker__start__timeout__expired)
+{
+    threadpool threads(1);
+    request_tracker tracker(threads, 60);
+    std::promise<hash_digest> expired;
+
+    tracker.start([&expired](const hash_digest& hash, channel::ptr)
+    {
+        expired.set_value(hash);
+    });
+
+    BOOST_REQUIRE(tracker.request(hash1, key(0),
+        request_tracker::duration::zero()));
+    BOOST_REQUIRE(tracker.request(hash2, key(0)));
+
+    auto result = expired.get_future();
+    BOOST_REQUIRE(result.wait_for(std::chrono::seconds(10)) ==
+        std::future_status::ready);
+    BOOST_REQUIRE(result.get() == hash1);
+
+    // The expired request is removed, so it may be asked of another channel.
+    BOOST_REQUIRE(!tracker.requested(hash1));
+    BOOST_REQUIRE(tracker.requested(hash2));
+    BOOST_REQUIRE(tracker.request(hash1, key(1)));
+
+    tracker.stop();
+    threads.shutdown();
+    threads.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+
+static uint32_t now()
+{
+    return static_cast<uint32_t>(std::time(nullptr));
+}
+
+BOOST_AUTO_TEST_SUITE(sync_state_tests)
+
+BOOST_AUTO_TEST_CASE(sync_state__status__default__initial_download)
+{
+    sync_state state(0, 60);
+    BOOST_REQUIRE(state.status() == sync_status::initial_download);
+    BOOST_REQUIRE(!state.synced());
+}
+
+BOOST_AUTO_TEST_CASE(sync_state__status__below_checkpoint__initial_download)
+{
+    sync_state state(100, 60);
+    state.set_top(99, now());
+    BOOST_REQUIRE(state.initial_download());
+}
+
+BOOST_AUTO_TEST_CASE(sync_state__status__old_top__initial_download)
+{
+    sync_state state(100, 60);
+    state.set_top(100, now() - 2 * 60 * 60);
+    BOOST_REQUIRE(state.initial_download());
+}
+
+BOOST_AUTO_TEST_CASE(sync_state__status__recent_top_at_target__synced)
+{
+    sync_state state(100, 60);
+    state.set_target(105);
+    state.set_top(100, now());
+    BOOST_REQUIRE(state.synced());
+}
+
+BOOST_AUTO_TEST_CASE(sync_state__status__behind_target__catching_up)
+{
+    sync_state state(100, 60);
+    state.set_target(200);
+    state.set_top(100, now());
+    BOOST_REQUIRE(state.status() == sync_status::catching_up);
+    BOOST_REQUIRE_EQUAL(state.target_height(), 200u);
+}
+
+BOOST_AUTO_TEST_CASE(sync_state__status__old_top_after_download__not_initial_download)
+{
+    sync_state state(0, 60);
+    state.set_top(100, now());
+    BOOST_REQUIRE(state.synced());
+    state.set_top(100, now() - 2 * 60 * 60);
+    BOOST_REQUIRE(state.synced());
+}
+
+BOOST_AUTO_TEST_CASE(sync_state__set_target__synced_then_behind__catching_up)
+{
+    sync_state state(0, 60);
+    state.set_top(100, now());
+    BOOST_REQUIRE(state.synced());
+    state.set_target(200);
+    BOOST_REQUIRE(state.status() == sync_status::catching_up);
+    state.set_top(200, now());
+    BOOST_REQUIRE(state.synced());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
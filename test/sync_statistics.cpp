@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2011-2015 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin-node.
+ *
+ * libbitcoin-node is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License with
+ * additional permissions to the one published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version. For more information see LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+#include <bitcoin/node.hpp>
+
+using namespace bc;
+using namespace bc::node;
+using std::chrono::milliseconds;
+
+BOOST_AUTO_TEST_SUITE(sync_statistics_tests)
+
+BOOST_AUTO_TEST_CASE(sync_statistics__progress__default__zero)
+{
+    sync_statistics statistics;
+    const auto progress = statistics.progress();
+    BOOST_REQUIRE_EQUAL(progress.height, 0u);
+    BOOST_REQUIRE_EQUAL(progress.orphaned_total, 0u);
+    BOOST_REQUIRE_EQUAL(progress.store_p50_milliseconds, 0u);
+    BOOST_REQUIRE_EQUAL(progress.eta_seconds, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(sync_statistics__sample__stored__expected_height_and_counts)
+{
+    sync_statistics statistics;
+    statistics.stored(42, 3, milliseconds(10));
+    statistics.stored(41, 1, milliseconds(10));
+    statistics.orphaned();
+    const auto progress = statistics.sample(7, 100);
+    BOOST_REQUIRE_EQUAL(progress.height, 42u);
+    BOOST_REQUIRE_EQUAL(progress.target_height, 100u);
+    BOOST_REQUIRE_EQUAL(progress.orphaned_total, 1u);
+    BOOST_REQUIRE_EQUAL(progress.in_flight, 7u);
+}
+
+BOOST_AUTO_TEST_CASE(sync_statistics__sample__target_below_height__height)
+{
+    sync_statistics statistics;
+    statistics.stored(42, 1, milliseconds(1));
+    const auto progress = statistics.sample(0, 0);
+    BOOST_REQUIRE_EQUAL(progress.target_height, 42u);
+    BOOST_REQUIRE_EQUAL(progress.eta_seconds, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(sync_statistics__sample__latencies__expected_percentiles)
+{
+    sync_statistics statistics;
+
+    for (auto latency = 1; latency <= 100; ++latency)
+        statistics.stored(latency, 1, milliseconds(latency));
+
+    const auto progress = statistics.sample(0, 100);
+    BOOST_REQUIRE_EQUAL(progress.store_p50_milliseconds, 50u);
+    BOOST_REQUIRE_EQUAL(progress.store_p90_milliseconds, 90u);
+    BOOST_REQUIRE_EQUAL(progress.store_p99_milliseconds, 99u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()